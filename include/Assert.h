@@ -8,6 +8,10 @@
 
 #ifdef ASSERT
 
+	// Runs before aborting, so buffered output like the logger's makes it out
+	inline void (*assertHook)(void*) = nullptr;
+	inline void* assertHookUser = nullptr;
+
 	inline void AssertFail(const char* expr, const char* file, int line, const char* func, const char* fmt = nullptr, ...)
 	{
 	    std::fprintf(stderr, "[ASSERTION FAILED]\n");
@@ -25,6 +29,12 @@
 	    }
 
 	    std::fflush(stderr);
+
+	    if (assertHook)
+	    {
+	        assertHook(assertHookUser);
+	    }
+
 	    std::abort();
 }
 
@@ -37,4 +47,4 @@
 
 	#define Assert(expr, ...) ((void)0)
 
-#endif
+#endif
\ No newline at end of file
@@ -90,6 +90,25 @@ namespace Lua
 		}
 	}
 
+	// Runs code already in memory, name is used in error messages
+	inline bool LoadBuffer(sol::state& lua, sol::environment& env, const std::string_view code, const std::string& name)
+	{
+		sol::protected_function_result result = lua.safe_script(code, env, sol::script_default_on_error, "@" + name);
+
+		if (result.valid())
+		{
+			return true;
+		}
+
+		else
+		{
+			sol::error e = result;
+			LogColor(LOG_YELLOW, "Failed to load lua file ", name, " with error: ", e.what());
+
+			return false;
+		}
+	}
+
 	template<typename T>
 	std::optional<T> GetValue(sol::state& lua, const std::string& key)
 	{
@@ -238,6 +257,25 @@ namespace Lua
 		}
 	}
 
+	// Calls an already resolved function, name is only used in error messages
+	template<typename... Args>
+	bool Call(const sol::protected_function& function, const std::string& name, Args&&... args)
+	{
+		sol::protected_function_result result = function(std::forward<Args>(args)...);
+		if (result.valid())
+		{
+			return true;
+		}
+
+		else
+		{
+			sol::error e = result;
+			LogColor(LOG_YELLOW, "Invalid call of function ", name, " with error: ", e.what());
+
+			return false;
+		}
+	}
+
 	template<typename T, typename... Args>
 	std::optional<T> CallFunctionWithReturn(sol::state& lua, const std::string& key, Args&&... args)
 	{
@@ -0,0 +1,267 @@
+#include "AssetPack.h"
+
+#include "Log/Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+	#include <fstream>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+AssetPack::~AssetPack()
+{
+	Close();
+}
+
+bool AssetPack::Open(const char* path)
+{
+	Close();
+
+#ifdef _WIN32
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		return false;
+	}
+
+	_buffer.resize(file.tellg());
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(_buffer.data()), _buffer.size());
+
+	_data = _buffer.data();
+	_size = _buffer.size();
+#else
+	const int file = open(path, O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		close(file);
+
+		return false;
+	}
+
+	void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if (mapping == MAP_FAILED)
+	{
+		return false;
+	}
+
+	_data = static_cast<const u8*>(mapping);
+	_size = info.st_size;
+#endif
+
+	_header = reinterpret_cast<const Pack::Header*>(_data);
+
+	if (_size < sizeof(Pack::Header) || std::memcmp(_header->magic, Pack::magic, sizeof(Pack::magic)) != 0 || _header->version != Pack::version
+		|| _size < sizeof(Pack::Header) + (u64)_header->entryCount * sizeof(Pack::Entry))
+	{
+		LogColor(LOG_YELLOW, "Invalid asset pack ", path);
+
+		Close();
+
+		return false;
+	}
+
+	_entries = reinterpret_cast<const Pack::Entry*>(_data + sizeof(Pack::Header));
+
+	return true;
+}
+
+void AssetPack::Close()
+{
+	if (!_data)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	_buffer.clear();
+	_buffer.shrink_to_fit();
+#else
+	munmap(const_cast<u8*>(_data), _size);
+#endif
+
+	_data = nullptr;
+	_size = 0;
+	_header = nullptr;
+	_entries = nullptr;
+}
+
+bool AssetPack::IsOpen() const
+{
+	return _data != nullptr;
+}
+
+void AssetPack::SetLooseFileOverride(const bool enabled)
+{
+	_looseFileOverride = enabled;
+}
+
+std::span<const u8> AssetPack::Find(const ResourceId id, Pack::PayloadType* type) const
+{
+	if (!_data)
+	{
+		return {};
+	}
+
+	const Pack::Entry* end = _entries + _header->entryCount;
+	const Pack::Entry* entry = std::lower_bound(_entries, end, id.hash, [](const Pack::Entry& entry, const u64 hash)
+	{
+		return entry.id < hash;
+	});
+
+	if (entry == end || entry->id != id.hash || entry->offset + entry->size > _size)
+	{
+		return {};
+	}
+
+	if (type)
+	{
+		*type = static_cast<Pack::PayloadType>(entry->type);
+	}
+
+	return {_data + entry->offset, entry->size};
+}
+
+bool AssetPack::Contains(const std::string_view path) const
+{
+	return !Find(ResourceId(path)).empty();
+}
+
+Wave AssetPack::LoadWave(const char* path) const
+{
+	Pack::PayloadType type;
+	std::span<const u8> payload = UseLooseFile(path) ? std::span<const u8>() : Find(ResourceId(path), &type);
+
+	if (payload.empty())
+	{
+		return ::LoadWave(path);
+	}
+
+	if (type == Pack::PayloadType::Wave)
+	{
+		const Pack::WaveHeader* header = reinterpret_cast<const Pack::WaveHeader*>(payload.data());
+		if (payload.size() < sizeof(Pack::WaveHeader) || Pack::GetWaveDataSize(*header) == 0 || Pack::GetWaveDataSize(*header) > payload.size() - sizeof(Pack::WaveHeader))
+		{
+			LogColor(LOG_YELLOW, "Corrupt wave ", path, " in the asset pack, loading the loose file");
+
+			return ::LoadWave(path);
+		}
+
+		Wave wave;
+		wave.frameCount = header->frameCount;
+		wave.sampleRate = header->sampleRate;
+		wave.sampleSize = header->sampleSize;
+		wave.channels = header->channels;
+		wave.data = const_cast<u8*>(payload.data() + sizeof(Pack::WaveHeader));
+
+		return wave;
+	}
+
+	return LoadWaveFromMemory(GetFileExtension(path), payload.data(), payload.size());
+}
+
+Image AssetPack::LoadImage(const char* path) const
+{
+	Pack::PayloadType type;
+	std::span<const u8> payload = UseLooseFile(path) ? std::span<const u8>() : Find(ResourceId(path), &type);
+
+	if (payload.empty())
+	{
+		return ::LoadImage(path);
+	}
+
+	if (type == Pack::PayloadType::Image)
+	{
+		const Pack::ImageHeader* header = reinterpret_cast<const Pack::ImageHeader*>(payload.data());
+		if (payload.size() < sizeof(Pack::ImageHeader) || Pack::GetImageDataSize(*header) == 0 || Pack::GetImageDataSize(*header) > payload.size() - sizeof(Pack::ImageHeader))
+		{
+			LogColor(LOG_YELLOW, "Corrupt image ", path, " in the asset pack, loading the loose file");
+
+			return ::LoadImage(path);
+		}
+
+		Image image;
+		image.width = header->width;
+		image.height = header->height;
+		image.mipmaps = header->mipmaps;
+		image.format = header->format;
+		image.data = const_cast<u8*>(payload.data() + sizeof(Pack::ImageHeader));
+
+		return image;
+	}
+
+	return LoadImageFromMemory(GetFileExtension(path), payload.data(), payload.size());
+}
+
+std::string_view AssetPack::FindText(const char* path) const
+{
+	if (UseLooseFile(path))
+	{
+		return {};
+	}
+
+	std::span<const u8> payload = Find(ResourceId(path));
+
+	return std::string_view(reinterpret_cast<const char*>(payload.data()), payload.size());
+}
+
+void AssetPack::UnloadWave(Wave wave) const
+{
+	if (!Owns(wave.data))
+	{
+		::UnloadWave(wave);
+	}
+}
+
+void AssetPack::UnloadImage(Image image) const
+{
+	if (!Owns(image.data))
+	{
+		::UnloadImage(image);
+	}
+}
+
+std::vector<std::string_view> AssetPack::GetPaths() const
+{
+	std::vector<std::string_view> paths;
+
+	if (!_data)
+	{
+		return paths;
+	}
+
+	paths.reserve(_header->entryCount);
+	for (u32 i = 0; i < _header->entryCount; i++)
+	{
+		const Pack::Entry& entry = _entries[i];
+		paths.emplace_back(reinterpret_cast<const char*>(_data + entry.pathOffset), entry.pathSize);
+	}
+
+	return paths;
+}
+
+bool AssetPack::UseLooseFile(const char* path) const
+{
+	return !_data || (_looseFileOverride && FileExists(path));
+}
+
+bool AssetPack::Owns(const void* pointer) const
+{
+	const u8* bytes = static_cast<const u8*>(pointer);
+
+	return _data && bytes >= _data && bytes < _data + _size;
+}
\ No newline at end of file
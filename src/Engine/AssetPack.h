@@ -0,0 +1,161 @@
+#pragma once
+
+#include "Types.h"
+
+#include "ResourceId.h"
+
+#include "Raylib/raylib.h"
+
+#include <algorithm>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Pack layout, little endian:
+// PackHeader, PackEntry[entryCount] sorted by id, path strings, then aligned payloads
+namespace Pack
+{
+	inline constexpr char magic[4] = {'S', 'P', 'A', 'K'};
+	inline constexpr u32 version = 1;
+	inline constexpr u32 defaultAlignment = 16;
+
+	enum class PayloadType : u32
+	{
+		Raw, // File bytes as they are on disk
+		Wave, // WaveHeader followed by decoded samples
+		Image, // ImageHeader followed by decoded pixels
+	};
+
+	struct Header
+	{
+		char magic[4];
+		u32 version;
+		u32 entryCount;
+		u32 alignment;
+	};
+
+	struct Entry
+	{
+		u64 id;
+		u64 offset;
+		u64 size;
+		u32 pathOffset;
+		u16 pathSize;
+		u16 type;
+	};
+
+	// Sized so the payload after it stays aligned
+	struct WaveHeader
+	{
+		u32 frameCount;
+		u32 sampleRate;
+		u32 sampleSize;
+		u32 channels;
+	};
+
+	struct ImageHeader
+	{
+		i32 width;
+		i32 height;
+		i32 mipmaps;
+		i32 format;
+	};
+
+	static_assert(sizeof(Header) == 16 && sizeof(Entry) == 32 && sizeof(WaveHeader) == 16 && sizeof(ImageHeader) == 16);
+
+	// Bytes of samples the header describes, zero when it can't be valid
+	inline u64 GetWaveDataSize(const WaveHeader& header)
+	{
+		if (header.sampleSize != 8 && header.sampleSize != 16 && header.sampleSize != 32)
+		{
+			return 0;
+		}
+
+		return (u64)header.frameCount * header.channels * header.sampleSize / 8;
+	}
+
+	// Bytes of every mip level like GetPixelDataSize, in 64 bits so corrupt sizes can't overflow. Zero when it can't be valid
+	inline u64 GetImageDataSize(const ImageHeader& header)
+	{
+		// A 4x4 block is exact for every format, compressed ones included
+		const u64 blockSize = GetPixelDataSize(4, 4, header.format);
+		if (header.width <= 0 || header.height <= 0 || header.mipmaps < 1 || header.mipmaps > 32 || !blockSize)
+		{
+			return 0;
+		}
+
+		u64 size = 0;
+		i32 width = header.width;
+		i32 height = header.height;
+
+		for (i32 level = 0; level < header.mipmaps; level++)
+		{
+			size += width < 4 && height < 4 ? GetPixelDataSize(width, height, header.format) : (u64)width * height * blockSize / 16;
+
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+		}
+
+		return size;
+	}
+}
+
+// Read only memory mapped archive, loads point straight into the mapping when the payload was stored decoded
+class AssetPack
+{
+public:
+
+	AssetPack() = default;
+	~AssetPack();
+
+	AssetPack(const AssetPack&) = delete;
+	AssetPack& operator=(const AssetPack&) = delete;
+
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const;
+
+	// Loose files on disk take precedence over the pack, for hot reloading during development
+	void SetLooseFileOverride(const bool enabled);
+
+	// Empty if the pack doesn't hold the file
+	std::span<const u8> Find(const ResourceId id, Pack::PayloadType* type = nullptr) const;
+	bool Contains(const std::string_view path) const;
+
+	// Fall back to the loose file when the pack doesn't hold it or its entry is corrupt, safe to call from loader threads
+	// Decoded entries point into the read only mapping, copy them with WaveCopy or ImageCopy before changing them in place
+	Wave LoadWave(const char* path) const;
+	Image LoadImage(const char* path) const;
+
+	// View into the mapping, empty when the loose file should be read instead
+	std::string_view FindText(const char* path) const;
+
+	// Only frees memory that doesn't belong to the mapping
+	void UnloadWave(Wave wave) const;
+	void UnloadImage(Image image) const;
+
+	std::vector<std::string_view> GetPaths() const;
+
+private:
+
+	bool UseLooseFile(const char* path) const;
+
+	bool Owns(const void* pointer) const;
+
+private:
+
+	const u8* _data = nullptr;
+	u64 _size = 0;
+
+	const Pack::Header* _header = nullptr;
+	const Pack::Entry* _entries = nullptr;
+
+	bool _looseFileOverride = false;
+
+#ifdef _WIN32
+	// No mapping on windows, the file is read once into memory instead
+	std::vector<u8> _buffer;
+#endif
+};
\ No newline at end of file
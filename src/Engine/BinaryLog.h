@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Types.h"
+
+#include <chrono>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
+
+// Binary log layout, little endian. A Header, then entries each starting with an EntryType byte:
+// Site: u32 id, u8 level, u32 line, u16 size + file, u16 size + format, u8 count + Argument[count]
+// Record: u32 site, u64 counter, u8 size + argument bytes, strings as u16 size + bytes
+// Sync: u64 counter, i64 system clock nanoseconds, the decoder interpolates record times between them
+// Dropped: u64 count
+namespace BinaryLog
+{
+	inline constexpr char magic[4] = {'S', 'L', 'O', 'G'};
+	inline constexpr u32 version = 1;
+
+	// Longer strings are cut, so the argument sizes of a site are known when it compiles
+	inline constexpr u32 maxString = 48;
+
+	enum class EntryType : u8
+	{
+		Site,
+		Record,
+		Sync,
+		Dropped,
+	};
+
+	enum class Argument : u8
+	{
+		Bool,
+		Char,
+		I8,
+		U8,
+		I16,
+		U16,
+		I32,
+		U32,
+		I64,
+		U64,
+		F32,
+		F64,
+		String,
+	};
+
+	struct Header
+	{
+		char magic[4];
+		u32 version;
+	};
+
+	// Timestamp counter, only ever compared to the Sync entries written alongside
+	inline u64 ReadCounter()
+	{
+		#if defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+		#else
+			return std::chrono::steady_clock::now().time_since_epoch().count();
+		#endif
+	}
+
+	template<typename T>
+	constexpr Argument GetArgument()
+	{
+		using Type = std::decay_t<T>;
+
+		if constexpr (std::is_enum_v<Type>)
+		{
+			return GetArgument<std::underlying_type_t<Type>>();
+		}
+		else if constexpr (std::is_same_v<Type, bool>)
+		{
+			return Argument::Bool;
+		}
+		else if constexpr (std::is_same_v<Type, char>)
+		{
+			return Argument::Char;
+		}
+		else if constexpr (std::is_integral_v<Type>)
+		{
+			constexpr u32 index = sizeof(Type) == 1 ? 0 : sizeof(Type) == 2 ? 1 : sizeof(Type) == 4 ? 2 : 3;
+			return Argument(u8(Argument::I8) + index * 2 + (std::is_unsigned_v<Type> ? 1 : 0));
+		}
+		else if constexpr (std::is_same_v<Type, float>)
+		{
+			return Argument::F32;
+		}
+		else if constexpr (std::is_same_v<Type, double>)
+		{
+			return Argument::F64;
+		}
+		else
+		{
+			static_assert(std::is_convertible_v<const T&, std::string_view>, "Binary logs take arithmetic, enum and string arguments");
+			return Argument::String;
+		}
+	}
+
+	// Most bytes an argument can take in a record
+	template<typename T>
+	constexpr u32 GetMaxSize()
+	{
+		using Type = std::decay_t<T>;
+
+		if constexpr (std::is_arithmetic_v<Type> || std::is_enum_v<Type>)
+		{
+			return sizeof(Type);
+		}
+		else
+		{
+			return sizeof(u16) + maxString;
+		}
+	}
+
+	constexpr u32 GetSize(const Argument argument)
+	{
+		switch (argument)
+		{
+			case Argument::Bool: case Argument::Char: case Argument::I8: case Argument::U8: return 1;
+			case Argument::I16: case Argument::U16: return 2;
+			case Argument::I32: case Argument::U32: case Argument::F32: return 4;
+			case Argument::I64: case Argument::U64: case Argument::F64: return 8;
+			case Argument::String: return 0;
+		}
+
+		return 0;
+	}
+}
\ No newline at end of file
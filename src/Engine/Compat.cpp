@@ -0,0 +1,23 @@
+// The prebuilt rlImGui library is compiled against glibc 2.38, which redirects sscanf to its c23 variant
+#if defined(__linux__)
+
+#include <cstdarg>
+#include <cstdio>
+
+#include <features.h>
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+
+extern "C" int __isoc23_sscanf(const char* buffer, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	const int result = vsscanf(buffer, format, args);
+	va_end(args);
+
+	return result;
+}
+
+#endif
+
+#endif
\ No newline at end of file
@@ -4,10 +4,57 @@
 #include "MyMath/MyVectors.h"
 
 #include "Lua/MyLua.h"
+#include "ResourceManager.h"
 #include "Types.h"
 
 #include <string>
 
+// Forward
+struct LuaBudget;
+
+// Lifecycle callbacks resolved once per load so calling them skips the environment lookup
+struct LuaCallbacks
+{
+	sol::protected_function update;
+
+	// Called once per tick with every entity using the script, takes over from Update when defined
+	sol::protected_function updateAll;
+
+	// Entity scripts only, called with each entity's instance once it is loaded
+	sol::protected_function start;
+
+	void Bind(const sol::environment& environment)
+	{
+		update = Resolve(environment, "Update");
+		updateAll = Resolve(environment, "UpdateAll");
+		start = Resolve(environment, "Start");
+	}
+
+	bool HasUpdate() const
+	{
+		return update.valid();
+	}
+
+	bool HasUpdateAll() const
+	{
+		return updateAll.valid();
+	}
+
+private:
+
+	// Raw so a missing callback doesn't fall through to the globals
+	static sol::protected_function Resolve(const sol::environment& environment, const char* name)
+	{
+		sol::object object = environment.raw_get<sol::object>(name);
+		if (object.get_type() == sol::type::function)
+		{
+			return object.as<sol::protected_function>();
+		}
+
+		return sol::protected_function();
+	}
+};
+
 namespace Component
 {
 	struct Transform
@@ -19,17 +66,44 @@ namespace Component
 
 	struct Sprite
 	{
-		Texture2D texture;
+		ResourceHandle<Texture2D> texture;
 		Rectangle rectangle = {0, 0, 0, 0};
 		Color color = WHITE;
 		float scale = 1;
 		u32 layer = 1;
 	};
 
+	// The environment is the entity's instance, its functions are shared by every entity using the path
 	struct LuaScript
 	{
 		sol::environment environment;
+		LuaCallbacks callbacks;
 		std::string path;
 		bool enabled = true;
+
+		// LuaAllocator owner the environment's memory is charged to
+		u32 memoryOwner = 0;
+
+		// Resolved when loaded so callbacks don't look it up by path
+		const LuaBudget* budget = nullptr;
+	};
+
+	// Entity scripts running in one of LuaManager's shards, the environment lives in that shard's state
+	struct LuaShardScript
+	{
+		std::string path;
+		u32 shard;
+	};
+
+	// Only entity scripts defining Update get this so the per tick view never visits the rest
+	struct LuaUpdate
+	{
+
+	};
+
+	// Entity scripts defining UpdateAll are updated together with the rest of their group
+	struct LuaBatchUpdate
+	{
+		u32 group;
 	};
 }
\ No newline at end of file
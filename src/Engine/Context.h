@@ -26,4 +26,69 @@ namespace Event
 	{
 
 	};
+
+	// A script took too long or ran too many instructions and was disabled
+	struct ScriptOverBudget
+	{
+		std::string path;
+		u32 entity;
+	};
+}
+
+template<typename T, typename... Args>
+void LuaManager::RegisterEvent(const std::string& name, Args&&... members)
+{
+	Assert(_context, "Context must be set first");
+
+	if (_eventQueues.contains(name))
+	{
+		return;
+	}
+
+	Lua::RegisterType<T>(lua, name, std::forward<Args>(members)...);
+
+	// Filled by the dispatcher's update, lua sees the batch in DispatchEvents
+	auto pending = std::make_shared<std::vector<T>>();
+
+	_context->dispatcher.template sink<T>().template connect<&LuaManager::QueueEvent<T>>(*pending);
+
+	LuaEventQueue& queue = _eventQueues[name];
+	queue.events = lua.create_table();
+
+	queue.fill = [this, pending](LuaEventQueue& queue) -> u32
+	{
+		lua_State* L = lua.lua_state();
+
+		queue.events.push();
+
+		// Copies, the pending vector is cleared and refilled every drain while lua can keep the events around
+		const u32 count = pending->size();
+		for (u32 i = 0; i < count; i++)
+		{
+			sol::stack::push(L, (*pending)[i]);
+			lua_rawseti(L, -2, i + 1);
+		}
+
+		for (u32 i = count; i < queue.count; i++)
+		{
+			lua_pushnil(L);
+			lua_rawseti(L, -2, i + 1);
+		}
+
+		lua_pop(L, 1);
+
+		queue.count = count;
+
+		return count;
+	};
+
+	queue.last = [this, pending]() -> sol::object
+	{
+		return pending->empty() ? sol::object() : sol::make_object(lua, pending->back());
+	};
+
+	queue.clear = [pending]()
+	{
+		pending->clear();
+	};
 }
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "FileWatcher.h"
+
+#include "Log/Log.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+FileWatcher::FileWatcher()
+{
+#ifdef __linux__
+	_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_descriptor < 0)
+	{
+		LogColor(LOG_YELLOW, "Failed to initialize inotify, file changes will not be detected");
+	}
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+	if (_descriptor >= 0)
+	{
+		close(_descriptor);
+	}
+#endif
+}
+
+bool FileWatcher::Watch(const std::string& path)
+{
+	if (_files.contains(path))
+	{
+		return true;
+	}
+
+	const std::string normalized = Normalize(path);
+
+#ifdef __linux__
+	if (_descriptor < 0)
+	{
+		return false;
+	}
+
+	const std::string directory = std::filesystem::path(normalized).parent_path().string();
+	if (!_directoryWatches.contains(directory))
+	{
+		const int watch = inotify_add_watch(_descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (watch < 0)
+		{
+			LogColor(LOG_YELLOW, "Failed to watch directory ", directory);
+
+			return false;
+		}
+
+		_directories[watch] = directory;
+		_directoryWatches[directory] = watch;
+	}
+#else
+	std::error_code error;
+	const std::filesystem::file_time_type time = std::filesystem::last_write_time(normalized, error);
+	if (error)
+	{
+		return false;
+	}
+
+	_writeTimes[normalized] = time;
+#endif
+
+	_files[path] = normalized;
+	_paths[normalized] = path;
+
+	return true;
+}
+
+void FileWatcher::Unwatch(const std::string& path)
+{
+	auto file = _files.find(path);
+	if (file == _files.end())
+	{
+		return;
+	}
+
+	const std::string normalized = file->second;
+	_files.erase(file);
+	_paths.erase(normalized);
+
+#ifdef __linux__
+	// Drop the directory watch once no file in it is left
+	const std::string directory = std::filesystem::path(normalized).parent_path().string();
+	const bool used = std::any_of(_paths.begin(), _paths.end(), [&directory](const auto& watched) {
+		return std::filesystem::path(watched.first).parent_path() == directory;
+	});
+
+	auto it = _directoryWatches.find(directory);
+	if (!used && it != _directoryWatches.end())
+	{
+		inotify_rm_watch(_descriptor, it->second);
+
+		_directories.erase(it->second);
+		_directoryWatches.erase(it);
+	}
+#else
+	_writeTimes.erase(normalized);
+#endif
+}
+
+bool FileWatcher::IsWatching(const std::string& path) const
+{
+	return _files.contains(path);
+}
+
+void FileWatcher::Poll(std::vector<std::string>& changed)
+{
+	const auto report = [this, &changed](const std::string& normalized)
+	{
+		auto it = _paths.find(normalized);
+		if (it != _paths.end() && std::find(changed.begin(), changed.end(), it->second) == changed.end())
+		{
+			changed.push_back(it->second);
+		}
+	};
+
+#ifdef __linux__
+	if (_descriptor < 0)
+	{
+		return;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+
+	while (true)
+	{
+		const ssize_t length = read(_descriptor, buffer, sizeof(buffer));
+		if (length <= 0)
+		{
+			if (length < 0 && errno != EAGAIN)
+			{
+				LogColor(LOG_YELLOW, "Failed to read inotify events");
+			}
+
+			break;
+		}
+
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			auto it = _directories.find(event->wd);
+			if (it == _directories.end() || !event->len)
+			{
+				continue;
+			}
+
+			report(it->second + "/" + event->name);
+		}
+	}
+#else
+	for (auto& [normalized, time] : _writeTimes)
+	{
+		std::error_code error;
+		const std::filesystem::file_time_type current = std::filesystem::last_write_time(normalized, error);
+		if (!error && current != time)
+		{
+			time = current;
+			report(normalized);
+		}
+	}
+#endif
+}
+
+std::string FileWatcher::Normalize(const std::string& path)
+{
+	std::error_code error;
+	const std::filesystem::path absolute = std::filesystem::weakly_canonical(path, error);
+
+	return error ? path : absolute.string();
+}
\ No newline at end of file
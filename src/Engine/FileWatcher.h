@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Types.h"
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Queues change events for watched files, inotify on linux and write time polling elsewhere
+class FileWatcher
+{
+public:
+
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// Watches the file's directory since editors often save by replacing the file
+	bool Watch(const std::string& path);
+	void Unwatch(const std::string& path);
+
+	bool IsWatching(const std::string& path) const;
+
+	// Drains the queued events, each changed path is reported once as it was passed to Watch
+	void Poll(std::vector<std::string>& changed);
+
+private:
+
+	static std::string Normalize(const std::string& path);
+
+private:
+
+	// Path given to Watch to its normalized path and back
+	std::unordered_map<std::string, std::string> _files;
+	std::unordered_map<std::string, std::string> _paths;
+
+#ifdef __linux__
+	int _descriptor = -1;
+
+	// Watch descriptor to normalized directory and back
+	std::unordered_map<int, std::string> _directories;
+	std::unordered_map<std::string, int> _directoryWatches;
+#else
+	std::unordered_map<std::string, std::filesystem::file_time_type> _writeTimes;
+#endif
+};
\ No newline at end of file
@@ -5,6 +5,11 @@
 
 #include "Renderer.h"
 
+#include "MyRaylib/MyRaylib.h"
+
+#define NO_FONT_AWESOME
+#include "rlImGui/rlImGui.h"
+
 Game::Game(const u32 windowWidth, const u32 windowHeight, const char* windowTitle)
 {
 	SetConfigFlags(FLAG_MSAA_4X_HINT | FLAG_WINDOW_RESIZABLE | FLAG_WINDOW_HIGHDPI | FLAG_WINDOW_ALWAYS_RUN);
@@ -14,21 +19,72 @@ Game::Game(const u32 windowWidth, const u32 windowHeight, const char* windowTitl
 	InitWindow(windowWidth, windowHeight, windowTitle);
 	SetExitKey(KEY_NULL);
 
+	rlImGuiSetup(true);
+
+	// Packed assets are optional, everything falls back to loose files
+	if (FileExists("assets.pak"))
+	{
+		_resourceManager.MountPack("assets.pak");
+	}
+
+	// Source images for the atlas and anything else needing pixels on the cpu
+	const AssetPack& pack = _resourceManager.GetPack();
+	ResourceCache<Image>& images = _resourceManager.AddCache<Image>([&pack](const char* path)
+	{
+		return pack.LoadImage(path);
+	},
+	[&pack](Image image)
+	{
+		pack.UnloadImage(image);
+	});
+	images.SetSizeFunction(GetImageMemorySize);
+
+	ResourceCache<Texture2D>& textures = _resourceManager.AddCache<Texture2D>([&pack](const char* path)
+	{
+		Image image = pack.LoadImage(path);
+		Texture2D texture = LoadTextureFromImage(image);
+		pack.UnloadImage(image);
+
+		return texture;
+	}, UnloadTexture);
+	textures.SetSizeFunction(GetTextureMemorySize);
+
+	// Decoding happens on loader threads, only the gpu upload is on the main thread
+	textures.SetAsyncFunctions([&pack](const char* path)
+	{
+		return pack.LoadImage(path);
+	},
+	[&pack](Image& image)
+	{
+		Texture2D texture = LoadTextureFromImage(image);
+		pack.UnloadImage(image);
+
+		return texture;
+	});
+
 	_context.emplace(_registry, _dispatcher, _renderer, _resourceManager, _sceneManager, _systemManager, _luaManager, _logger);
 	_sceneManager.SetContext(_context.value());
 	_systemManager.SetContext(_context.value());
 	_luaManager.SetContext(_context.value());
 
+	// Per tick logging goes through the binary log, read it back with logdecode
+	_logger.SetBinaryLogFile("log.bin");
+
+	// Collection happens in the slack after rendering instead of inside script callbacks
+	_luaManager.SetGarbageBudget(0.002, MB(256));
+
 	// Set event catcher
 	_dispatcher.sink<Event::CloseGame>().connect<&Game::OnCloseGameEvent>(this);
 }
 
 Game::~Game()
 {
+	_renderer.atlas.Clear();
 	_resourceManager.ClearCaches();
 
 	_context->registry.clear();
 
+	rlImGuiShutdown();
 	CloseWindow();
 }
 
@@ -44,6 +100,8 @@ void Game::Run(const u32 targetFps)
 
 	while(_running && !WindowShouldClose())
 	{
+		const double frameStart = GetTime();
+
 		const float deltaT = std::min(GetFrameTime(), 1.0f);
 		accummulator += deltaT;
 
@@ -55,9 +113,16 @@ void Game::Run(const u32 targetFps)
 
 			_sceneManager.Update(timeStep);
 
+			// Events queued during the step reach c++ handlers and then lua subscribers, one batch per type
+			_dispatcher.update();
+			_luaManager.DispatchEvents();
+
 			accummulator -= timeStep;
 		}
 
+		_resourceManager.Update();
+		_luaManager.ReloadChangedScripts();
+
 		BeginDrawing();
 		ClearBackground(BLANK);
 
@@ -67,6 +132,21 @@ void Game::Run(const u32 targetFps)
 
 		_sceneManager.Draw();
 
+		// Debug panels
+		if (IsKeyPressed(KEY_F3))
+		{
+			_luaManager.profiler.SetEnabled(!_luaManager.profiler.IsEnabled());
+		}
+
+		if (_luaManager.profiler.IsEnabled())
+		{
+			rlImGuiBegin();
+			_luaManager.profiler.DrawPanel();
+			rlImGuiEnd();
+		}
+
+		_luaManager.CollectGarbage(timeStep - (GetTime() - frameStart));
+
 		EndDrawing();
 	}
 }
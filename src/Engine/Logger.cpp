@@ -0,0 +1,364 @@
+#include "Logger.h"
+
+#include "Assert.h"
+
+#include <cstdio>
+
+struct SiteInfo
+{
+	LogLevel level;
+	const char* format;
+	const char* file;
+	u32 line;
+	std::vector<BinaryLog::Argument> arguments;
+};
+
+// Shared by every logger, a site's id is its index plus one
+static std::mutex siteMutex;
+static std::vector<SiteInfo> sites;
+
+template<typename T>
+static void Put(std::vector<u8>& buffer, const T& value)
+{
+	const u8* bytes = reinterpret_cast<const u8*>(&value);
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+static void PutString(std::vector<u8>& buffer, const std::string_view text)
+{
+	Put(buffer, u16(text.size()));
+	buffer.insert(buffer.end(), text.begin(), text.end());
+}
+
+Logger::Logger() :
+	_slots(new Slot[recordCount])
+{
+	for (u32 i = 0; i < recordCount; i++)
+	{
+		_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	if (!assertHook)
+	{
+		assertHook = OnAssert;
+		assertHookUser = this;
+	}
+
+	_thread = std::thread(&Logger::Run, this);
+}
+
+Logger::~Logger()
+{
+	if (assertHookUser == this)
+	{
+		assertHook = nullptr;
+		assertHookUser = nullptr;
+	}
+
+	_stop.store(true, std::memory_order_release);
+	_wake.notify_one();
+	_thread.join();
+}
+
+void Logger::SetLogFile(const char* path)
+{
+	std::lock_guard<std::mutex> lock(_fileMutex);
+
+	if (_file.is_open())
+	{
+		_file.close();
+	}
+
+	_file.open(path, std::ios::app);
+}
+
+void Logger::SetBinaryLogFile(const char* path)
+{
+	std::lock_guard<std::mutex> lock(_fileMutex);
+
+	if (_binaryFile.is_open())
+	{
+		_binaryFile.write(reinterpret_cast<const char*>(_binaryBuffer.data()), _binaryBuffer.size());
+		_binaryFile.close();
+	}
+
+	_binaryBuffer.clear();
+	_binarySites = 0;
+	_binaryDropped = _dropped.load(std::memory_order_relaxed);
+
+	_binaryFile.open(path, std::ios::binary | std::ios::trunc);
+	if (_binaryFile.is_open())
+	{
+		WriteBinaryHeader();
+	}
+
+	_binary.store(_binaryFile.is_open(), std::memory_order_relaxed);
+}
+
+void Logger::Flush()
+{
+	const u64 target = _head.load(std::memory_order_acquire);
+
+	u64 written = _written.load(std::memory_order_acquire);
+	while (written < target)
+	{
+		_wake.notify_one();
+		_written.wait(written, std::memory_order_acquire);
+		written = _written.load(std::memory_order_acquire);
+	}
+}
+
+u64 Logger::GetDroppedCount() const
+{
+	return _dropped.load(std::memory_order_relaxed);
+}
+
+Logger::Slot* Logger::Claim()
+{
+	u64 position = _head.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		Slot& slot = _slots[position & (recordCount - 1)];
+		const i64 difference = i64(slot.sequence.load(std::memory_order_acquire)) - i64(position);
+
+		if (difference == 0)
+		{
+			if (_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				return &slot;
+			}
+		}
+		else if (difference < 0)
+		{
+			// The writer hasn't read this slot since it was last used, the ring is full
+			return nullptr;
+		}
+		else
+		{
+			position = _head.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+void Logger::Publish(Slot* slot)
+{
+	slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+u32 Logger::RegisterSite(LogSite& site, std::initializer_list<BinaryLog::Argument> arguments)
+{
+	std::lock_guard<std::mutex> lock(siteMutex);
+
+	// Another thread may have got here first
+	u32 id = site.id.load(std::memory_order_relaxed);
+	if (id)
+	{
+		return id;
+	}
+
+	sites.push_back(SiteInfo{site.level, site.format, site.file, site.line, arguments});
+	id = sites.size();
+
+	site.id.store(id, std::memory_order_release);
+
+	return id;
+}
+
+void Logger::Run()
+{
+	while (true)
+	{
+		// Read before draining so everything published before the stop still gets written
+		const bool stop = _stop.load(std::memory_order_acquire);
+
+		Drain();
+
+		if (stop)
+		{
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(_wakeMutex);
+		_wake.wait_for(lock, std::chrono::milliseconds(10));
+	}
+}
+
+bool Logger::Drain()
+{
+	std::lock_guard<std::mutex> lock(_fileMutex);
+
+	const u64 start = _tail;
+
+	while (true)
+	{
+		Slot& slot = _slots[_tail & (recordCount - 1)];
+
+		// Claimed slots still being filled stop the drain, the rest waits for the next round
+		if (slot.sequence.load(std::memory_order_acquire) != _tail + 1)
+		{
+			break;
+		}
+
+		if (slot.record.site)
+		{
+			if (_binaryFile.is_open())
+			{
+				WriteBinaryRecord(slot.record);
+			}
+		}
+
+		else
+		{
+			WriteRecord(slot.record);
+		}
+
+		slot.sequence.store(_tail + recordCount, std::memory_order_release);
+		_tail++;
+	}
+
+	WriteDropped();
+
+	if (_tail == start && _fileBuffer.empty() && _consoleBuffer.empty() && _binaryBuffer.empty())
+	{
+		return false;
+	}
+
+	if (_binaryFile.is_open() && !_binaryBuffer.empty())
+	{
+		WriteBinarySync();
+
+		_binaryFile.write(reinterpret_cast<const char*>(_binaryBuffer.data()), _binaryBuffer.size());
+		_binaryFile.flush();
+	}
+
+	// One write per round, stderr isn't buffered
+	if (_file.is_open())
+	{
+		_file.write(_fileBuffer.data(), _fileBuffer.size());
+		_file.flush();
+	}
+
+	std::fwrite(_consoleBuffer.data(), 1, _consoleBuffer.size(), stderr);
+	std::fflush(stderr);
+
+	_fileBuffer.clear();
+	_consoleBuffer.clear();
+	_binaryBuffer.clear();
+
+	_written.store(_tail, std::memory_order_release);
+	_written.notify_all();
+
+	return true;
+}
+
+void Logger::WriteRecord(const Record& record)
+{
+	// Only the writer formats times, no need for the shared lock but once a second
+	const time_t seconds = std::chrono::system_clock::to_time_t(record.time);
+	if (seconds != _timeSeconds)
+	{
+		std::tm timeInfo;
+		GetThreadSafeLocalTime(seconds, timeInfo);
+		std::strftime(_timeText, sizeof(_timeText), "%H:%M:%S", &timeInfo);
+
+		_timeSeconds = seconds;
+	}
+
+	const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()) % 1000;
+
+	char prefix[48];
+	const int size = std::snprintf(prefix, sizeof(prefix), "[%s.%03d] [%s] ", _timeText, int(milliseconds.count()), LevelName(record.level));
+	const std::string_view message(record.message, record.length);
+
+	if (_file.is_open())
+	{
+		_fileBuffer.append(prefix, size).append(message).push_back('\n');
+	}
+
+	_consoleBuffer.append(LevelColor(record.level)).append(prefix, size).append(message).append(ANSI_RESET).push_back('\n');
+}
+
+void Logger::WriteDropped()
+{
+	const u64 dropped = _dropped.load(std::memory_order_relaxed);
+	if (dropped == _droppedReported)
+	{
+		return;
+	}
+
+	Record record;
+	record.time = std::chrono::system_clock::now();
+	record.level = LogLevel::WARN;
+	record.length = 0;
+	Append(record, "Log full, dropped ");
+	Append(record, dropped - _droppedReported);
+	Append(record, " records");
+
+	WriteRecord(record);
+
+	_droppedReported = dropped;
+
+	if (_binaryFile.is_open())
+	{
+		Put(_binaryBuffer, BinaryLog::EntryType::Dropped);
+		Put(_binaryBuffer, dropped - _binaryDropped);
+
+		_binaryDropped = dropped;
+	}
+}
+
+void Logger::WriteBinaryHeader()
+{
+	BinaryLog::Header header;
+	std::memcpy(header.magic, BinaryLog::magic, sizeof(header.magic));
+	header.version = BinaryLog::version;
+	Put(_binaryBuffer, header);
+
+	WriteBinarySync();
+}
+
+void Logger::WriteBinaryRecord(const Record& record)
+{
+	// Describe every site registered up to this one the first time the file sees any of them
+	if (record.site > _binarySites)
+	{
+		std::lock_guard<std::mutex> lock(siteMutex);
+
+		for (; _binarySites < sites.size(); _binarySites++)
+		{
+			const SiteInfo& site = sites[_binarySites];
+
+			Put(_binaryBuffer, BinaryLog::EntryType::Site);
+			Put(_binaryBuffer, _binarySites + 1);
+			Put(_binaryBuffer, u8(site.level));
+			Put(_binaryBuffer, site.line);
+			PutString(_binaryBuffer, site.file);
+			PutString(_binaryBuffer, site.format);
+			Put(_binaryBuffer, u8(site.arguments.size()));
+			_binaryBuffer.insert(_binaryBuffer.end(), reinterpret_cast<const u8*>(site.arguments.data()), reinterpret_cast<const u8*>(site.arguments.data() + site.arguments.size()));
+		}
+	}
+
+	Put(_binaryBuffer, BinaryLog::EntryType::Record);
+	Put(_binaryBuffer, record.site);
+	Put(_binaryBuffer, record.counter);
+	Put(_binaryBuffer, u8(record.length));
+	_binaryBuffer.insert(_binaryBuffer.end(), record.message, record.message + record.length);
+}
+
+void Logger::WriteBinarySync()
+{
+	// Read after every record of the round claimed its counter
+	const u64 counter = BinaryLog::ReadCounter();
+	const i64 time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	Put(_binaryBuffer, BinaryLog::EntryType::Sync);
+	Put(_binaryBuffer, counter);
+	Put(_binaryBuffer, time);
+}
+
+void Logger::OnAssert(void* user)
+{
+	static_cast<Logger*>(user)->Flush();
+}
\ No newline at end of file
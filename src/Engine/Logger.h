@@ -1,9 +1,25 @@
 #pragma once
 
 #include "Log/Log.h"
+#include "Types.h"
 
-#include <mutex>
+#include "BinaryLog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <fstream>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 enum class LogLevel
 {
@@ -13,80 +29,286 @@ enum class LogLevel
     ERROR,
 };
 
+// A LogBinary call site, described to the binary log once instead of on every call
+struct LogSite
+{
+	LogLevel level;
+	const char* format;
+	const char* file;
+	u32 line;
+
+	// Zero until the first call registers it
+	std::atomic<u32> id = 0;
+};
+
+// Format holds {} for every argument, turned into text by the decoder
+#define LogBinary(logger, level, format, ...) \
+	do \
+	{ \
+		static LogSite logSite{level, format, __FILE__, __LINE__}; \
+		(logger).WriteBinary(logSite, ##__VA_ARGS__); \
+	} while (0)
+
+// Callers format into a slot of a lock free ring and return, a background thread adds the timestamp and does the writing
 class Logger
 {
 public:
-    
-    void SetLogLevel(const LogLevel level)
-    {
-    	std::lock_guard<std::mutex> lock(_mutex);
-
-    	_level = level;
-    }
-
-    void SetLogFile(const char* path)
-    {
-    	std::lock_guard<std::mutex> lock(_mutex);
-
-    	if(_file.is_open())
-    	{
-    		_file.close();
-    	}
-
-    	_file.open(path, std::ios::app);
-    }
-
-    template<typename... Args>
-    void Write(const LogLevel level, Args&&... args)
-    {
-    	if (level < _level)
-    	{
-    		return;
-    	}
-
-    	std::lock_guard<std::mutex> lock(_mutex);
-
-    	if (_file.is_open())
-    	{
-	        _file << "[" << GetCurrentTimeString() << "] " << "[" << LevelName(level) << "] ";
-	        (_file << ... << std::forward<Args>(args)) << '\n';
-	    }
-
-        std::cerr << LevelColor(level) << "[" << GetCurrentTimeString() << "] " << "[" << LevelName(level) << "] ";
-        (std::cerr << ... << std::forward<Args>(args)) << ANSI_RESET << '\n';
-    }
+
+	static constexpr u32 recordCount = 4096;
+	static constexpr u32 messageSize = 216;
+
+	Logger();
+	~Logger();
+
+	Logger(const Logger&) = delete;
+	Logger& operator=(const Logger&) = delete;
+
+	void SetLogLevel(const LogLevel level)
+	{
+		_level.store(level, std::memory_order_relaxed);
+	}
+
+	void SetLogFile(const char* path);
+
+	// Starts a new binary log, LogBinary calls are skipped while there is none
+	void SetBinaryLogFile(const char* path);
+
+	// Never blocks, when the ring is full the record is dropped and counted
+	template<typename... Args>
+	void Write(const LogLevel level, Args&&... args)
+	{
+		if (level < _level.load(std::memory_order_relaxed))
+		{
+			return;
+		}
+
+		Slot* slot = Claim();
+		if (!slot)
+		{
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+
+			return;
+		}
+
+		Record& record = slot->record;
+		record.time = std::chrono::system_clock::now();
+		record.level = level;
+		record.length = 0;
+		record.site = 0;
+		(Append(record, std::forward<Args>(args)), ...);
+
+		Publish(slot);
+	}
+
+	// Only the site id, a counter and the raw arguments are stored, formatting is left to the decoder
+	template<typename... Args>
+	void WriteBinary(LogSite& site, const Args&... args)
+	{
+		static_assert((BinaryLog::GetMaxSize<Args>() + ... + 0) <= messageSize, "Too many arguments for a binary log record");
+
+		if (site.level < _level.load(std::memory_order_relaxed) || !_binary.load(std::memory_order_relaxed))
+		{
+			return;
+		}
+
+		u32 id = site.id.load(std::memory_order_acquire);
+		if (!id)
+		{
+			id = RegisterSite(site, {BinaryLog::GetArgument<Args>()...});
+		}
+
+		Slot* slot = Claim();
+		if (!slot)
+		{
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+
+			return;
+		}
+
+		Record& record = slot->record;
+		record.counter = BinaryLog::ReadCounter();
+		record.level = site.level;
+		record.site = id;
+		record.length = 0;
+		(Store(record, args), ...);
+
+		Publish(slot);
+	}
+
+	// Returns once everything written before the call is in the file
+	void Flush();
+
+	u64 GetDroppedCount() const;
 
 private:
 
-	const char* LevelName(const LogLevel level)
+	// Text records have a time and no site, binary ones a counter and the site they came from
+	struct Record
+	{
+		std::chrono::system_clock::time_point time;
+		LogLevel level;
+		u32 length;
+		u32 site;
+		u64 counter;
+		char message[messageSize];
+	};
+
+	// Sequence equals the position a writer may claim it at, and position plus one once the record can be read
+	struct alignas(64) Slot
+	{
+		std::atomic<u64> sequence;
+		Record record;
+	};
+
+	static_assert((recordCount & (recordCount - 1)) == 0, "Record count must be a power of two");
+
+	Slot* Claim();
+	void Publish(Slot* slot);
+
+	static void AppendText(Record& record, const char* text, size_t size)
+	{
+		size = std::min<size_t>(size, messageSize - record.length);
+		std::memcpy(record.message + record.length, text, size);
+		record.length += size;
+	}
+
+	template<typename T>
+	static void Append(Record& record, const T& value)
+	{
+		using Type = std::decay_t<T>;
+
+		if constexpr (std::is_same_v<Type, char>)
+		{
+			AppendText(record, &value, 1);
+		}
+		else if constexpr (std::is_same_v<Type, bool>)
+		{
+			AppendText(record, value ? "1" : "0", 1);
+		}
+		else if constexpr (std::is_arithmetic_v<Type>)
+		{
+			char* end = record.message + messageSize;
+			auto [last, error] = std::to_chars(record.message + record.length, end, value);
+			record.length = error == std::errc() ? last - record.message : messageSize;
+		}
+		else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+		{
+			const std::string_view text = value;
+			AppendText(record, text.data(), text.size());
+		}
+		else if constexpr (std::is_pointer_v<Type>)
+		{
+			char* end = record.message + messageSize;
+			AppendText(record, "0x", 2);
+			auto [last, error] = std::to_chars(record.message + record.length, end, reinterpret_cast<uintptr_t>(value), 16);
+			record.length = error == std::errc() ? last - record.message : messageSize;
+		}
+		else
+		{
+			// Anything else only knows how to stream itself
+			std::ostringstream stream;
+			stream << value;
+			const std::string text = stream.str();
+			AppendText(record, text.data(), text.size());
+		}
+	}
+
+	template<typename T>
+	static void Store(Record& record, const T& value)
+	{
+		using Type = std::decay_t<T>;
+
+		if constexpr (std::is_arithmetic_v<Type> || std::is_enum_v<Type>)
+		{
+			std::memcpy(record.message + record.length, &value, sizeof(Type));
+			record.length += sizeof(Type);
+		}
+		else
+		{
+			const std::string_view text = value;
+			const u16 size = std::min<size_t>(text.size(), BinaryLog::maxString);
+			std::memcpy(record.message + record.length, &size, sizeof(size));
+			std::memcpy(record.message + record.length + sizeof(size), text.data(), size);
+			record.length += sizeof(size) + size;
+		}
+	}
+
+	static u32 RegisterSite(LogSite& site, std::initializer_list<BinaryLog::Argument> arguments);
+
+	void Run();
+	bool Drain();
+	void WriteRecord(const Record& record);
+	void WriteDropped();
+
+	void WriteBinaryHeader();
+	void WriteBinaryRecord(const Record& record);
+	void WriteBinarySync();
+
+	static void OnAssert(void* user);
+
+	static const char* LevelName(const LogLevel level)
 	{
 		switch (level)
 		{
-            case LogLevel::DEBUG: return "DEBUG";
-            case LogLevel::INFO: return "INFO";
-            case LogLevel::WARN: return "WARN";
-            case LogLevel::ERROR: return "ERROR";
-        }
+			case LogLevel::DEBUG: return "DEBUG";
+			case LogLevel::INFO: return "INFO";
+			case LogLevel::WARN: return "WARN";
+			case LogLevel::ERROR: return "ERROR";
+		}
 
-        return "UNKNOWN";
-    }
+		return "UNKNOWN";
+	}
 
-    const char* LevelColor(const LogLevel level)
+	static const char* LevelColor(const LogLevel level)
 	{
 		switch (level)
 		{
-            case LogLevel::DEBUG: return LOG_BLUE;
-            case LogLevel::INFO: return LOG_WHITE;
-            case LogLevel::WARN: return LOG_YELLOW;
-            case LogLevel::ERROR: return LOG_RED;
-        }
+			case LogLevel::DEBUG: return LOG_BLUE;
+			case LogLevel::INFO: return LOG_WHITE;
+			case LogLevel::WARN: return LOG_YELLOW;
+			case LogLevel::ERROR: return LOG_RED;
+		}
 
-        return LOG_WHITE;
-    }
+		return LOG_WHITE;
+	}
 
 private:
 
-    std::ofstream _file;
-    LogLevel _level = LogLevel::DEBUG;
-    std::mutex _mutex;	
+	std::unique_ptr<Slot[]> _slots;
+
+	// Claimed by any thread, read only by the writer. Apart so producers and the writer don't share a line
+	alignas(64) std::atomic<u64> _head = 0;
+	alignas(64) u64 _tail = 0;
+
+	alignas(64) std::atomic<u64> _dropped = 0;
+	std::atomic<LogLevel> _level = LogLevel::DEBUG;
+	std::atomic<bool> _binary = false;
+
+	// Position the writer has written and flushed up to
+	std::atomic<u64> _written = 0;
+	u64 _droppedReported = 0;
+
+	// Only taken by the writer and SetLogFile, never on the calling side of Write
+	std::mutex _fileMutex;
+	std::ofstream _file;
+
+	// Writer side only, filled over a drain and written at once
+	std::string _fileBuffer;
+	std::string _consoleBuffer;
+	time_t _timeSeconds = -1;
+	char _timeText[9] = {};
+
+	std::ofstream _binaryFile;
+	std::vector<u8> _binaryBuffer;
+
+	// Sites already described in the current binary file
+	u32 _binarySites = 0;
+	u64 _binaryDropped = 0;
+
+	// The writer polls on a timeout, Flush and shutdown wake it early
+	std::mutex _wakeMutex;
+	std::condition_variable _wake;
+	std::atomic<bool> _stop = false;
+
+	std::thread _thread;
 };
\ No newline at end of file
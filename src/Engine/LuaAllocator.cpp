@@ -0,0 +1,255 @@
+#include "LuaAllocator.h"
+
+#include "Assert.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	// Class index for every multiple of 8 up to the largest class
+	constexpr u32 granularity = 8;
+}
+
+LuaAllocator::LuaAllocator()
+{
+	// Index 0 is noOwner
+	_owned.push_back(0);
+	_removed.push_back(0);
+}
+
+LuaAllocator::~LuaAllocator()
+{
+	// Closing the state freed every block, only the chunks are left
+	for (void* chunk : _chunks)
+	{
+		std::free(chunk);
+	}
+}
+
+void* LuaAllocator::Allocate(void* user, void* pointer, size_t oldSize, size_t newSize)
+{
+	LuaAllocator& allocator = *static_cast<LuaAllocator*>(user);
+
+	if (!newSize)
+	{
+		if (pointer)
+		{
+			allocator.FreeBlock(pointer, oldSize);
+		}
+
+		return nullptr;
+	}
+
+	if (pointer)
+	{
+		const u32 oldClass = GetClass(oldSize + sizeof(Header));
+		const u32 newClass = GetClass(newSize + sizeof(Header));
+
+		// Still fits its block, only the accounting changes
+		if (oldClass == newClass && oldClass != largeClass)
+		{
+			const Header* header = reinterpret_cast<const Header*>(static_cast<u8*>(pointer) - sizeof(Header));
+			allocator.Charge(header->owner, i64(newSize) - i64(oldSize));
+			allocator._stats.used += newSize - oldSize;
+
+			return pointer;
+		}
+	}
+
+	void* block = allocator.AllocateBlock(newSize);
+	if (block && pointer)
+	{
+		std::memcpy(block, pointer, std::min(oldSize, newSize));
+
+		allocator.FreeBlock(pointer, oldSize);
+	}
+
+	return block;
+}
+
+u32 LuaAllocator::AddOwner()
+{
+	if (!_freeOwners.empty())
+	{
+		const u32 owner = _freeOwners.back();
+		_freeOwners.pop_back();
+
+		return owner;
+	}
+
+	_owned.push_back(0);
+	_removed.push_back(0);
+
+	return _owned.size() - 1;
+}
+
+void LuaAllocator::RemoveOwner(const u32 owner)
+{
+	if (owner == noOwner)
+	{
+		return;
+	}
+
+	Assert(owner < _owned.size(), "Invalid lua memory owner");
+
+	if (_owner == owner)
+	{
+		_owner = noOwner;
+	}
+
+	// Reused once the garbage collector freed everything still charged to it
+	if (!_owned[owner])
+	{
+		_freeOwners.push_back(owner);
+	}
+
+	else
+	{
+		_removed[owner] = 1;
+	}
+}
+
+void LuaAllocator::SetOwner(const u32 owner)
+{
+	_owner = owner;
+}
+
+u32 LuaAllocator::GetOwner() const
+{
+	return _owner;
+}
+
+u64 LuaAllocator::GetOwnerMemory(const u32 owner) const
+{
+	return owner < _owned.size() ? _owned[owner] : 0;
+}
+
+const LuaMemoryStats& LuaAllocator::GetStats() const
+{
+	return _stats;
+}
+
+u32 LuaAllocator::GetClass(const size_t size)
+{
+	static constexpr auto classes = []()
+	{
+		std::array<u8, classSizes.back() / granularity + 1> table = {};
+
+		u32 index = 0;
+		for (u32 i = 0; i < table.size(); i++)
+		{
+			while (classSizes[index] < i * granularity)
+			{
+				index++;
+			}
+
+			table[i] = index;
+		}
+
+		return table;
+	}();
+
+	if (size > classSizes.back())
+	{
+		return largeClass;
+	}
+
+	return classes[(size + granularity - 1) / granularity];
+}
+
+void* LuaAllocator::AllocateBlock(const size_t size)
+{
+	const size_t total = size + sizeof(Header);
+	const u32 sizeClass = GetClass(total);
+
+	void* memory = nullptr;
+
+	if (sizeClass == largeClass)
+	{
+		memory = std::malloc(total);
+		_stats.large += total;
+	}
+
+	else if (_freeLists[sizeClass])
+	{
+		memory = _freeLists[sizeClass];
+		_freeLists[sizeClass] = _freeLists[sizeClass]->next;
+	}
+
+	else
+	{
+		const u32 blockSize = classSizes[sizeClass];
+		if (_cursor + blockSize > _end)
+		{
+			void* chunk = std::malloc(chunkSize);
+			if (!chunk)
+			{
+				return nullptr;
+			}
+
+			_chunks.push_back(chunk);
+			_cursor = static_cast<u8*>(chunk);
+			_end = _cursor + chunkSize;
+
+			_stats.reserved += chunkSize;
+		}
+
+		memory = _cursor;
+		_cursor += blockSize;
+	}
+
+	if (!memory)
+	{
+		return nullptr;
+	}
+
+	Header* header = static_cast<Header*>(memory);
+	header->owner = _owner;
+
+	Charge(_owner, size);
+	_stats.used += size;
+	_stats.allocations++;
+
+	return header + 1;
+}
+
+void LuaAllocator::FreeBlock(void* block, const size_t size)
+{
+	Header* header = static_cast<Header*>(block) - 1;
+
+	Charge(header->owner, -i64(size));
+	_stats.used -= size;
+
+	const size_t total = size + sizeof(Header);
+	const u32 sizeClass = GetClass(total);
+
+	if (sizeClass == largeClass)
+	{
+		std::free(header);
+		_stats.large -= total;
+
+		return;
+	}
+
+	FreeNode* node = reinterpret_cast<FreeNode*>(header);
+	node->next = _freeLists[sizeClass];
+	_freeLists[sizeClass] = node;
+}
+
+void LuaAllocator::Charge(const u32 owner, const i64 bytes)
+{
+	if (owner == noOwner)
+	{
+		return;
+	}
+
+	_owned[owner] += bytes;
+
+	if (_removed[owner] && !_owned[owner])
+	{
+		_removed[owner] = 0;
+		_freeOwners.push_back(owner);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Types.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+struct LuaMemoryStats
+{
+	// Requested by the state, without headers
+	u64 used = 0;
+
+	// Arena chunks backing the pools, and blocks too big for any pool
+	u64 reserved = 0;
+	u64 large = 0;
+
+	u64 allocations = 0;
+};
+
+// lua_Alloc serving small blocks from size class pools carved out of a per state arena, and tagging every block with the environment that allocated it
+class LuaAllocator
+{
+public:
+
+	static constexpr u32 noOwner = 0;
+
+	LuaAllocator();
+	~LuaAllocator();
+
+	LuaAllocator(const LuaAllocator&) = delete;
+	LuaAllocator& operator=(const LuaAllocator&) = delete;
+
+	static void* Allocate(void* user, void* pointer, size_t oldSize, size_t newSize);
+
+	// Owners stand for environments, blocks allocated while one is current count towards it until freed
+	u32 AddOwner();
+	void RemoveOwner(const u32 owner);
+	void SetOwner(const u32 owner);
+	u32 GetOwner() const;
+
+	u64 GetOwnerMemory(const u32 owner) const;
+	const LuaMemoryStats& GetStats() const;
+
+private:
+
+	struct Header
+	{
+		u32 owner;
+		u32 padding;
+	};
+
+	struct FreeNode
+	{
+		FreeNode* next;
+	};
+
+	static constexpr size_t chunkSize = 64 * 1024;
+	// Fine steps for the small objects most of the heap is made of, like 64 byte tables
+	static constexpr std::array<u32, 31> classSizes = {
+		16, 24, 32, 40, 48, 56, 64, 72, 80, 88, 96, 104, 112, 120, 128,
+		144, 160, 176, 192, 208, 224, 240, 256,
+		288, 320, 352, 384, 416, 448, 480, 512
+	};
+
+	static constexpr u32 largeClass = classSizes.size();
+	static u32 GetClass(const size_t size);
+
+	// Sizes are what the state asked for, the header is added on top
+	void* AllocateBlock(const size_t size);
+	void FreeBlock(void* block, const size_t size);
+
+	void Charge(const u32 owner, const i64 bytes);
+
+private:
+
+	std::array<FreeNode*, classSizes.size()> _freeLists = {};
+
+	// Bump pointer into the newest chunk
+	std::vector<void*> _chunks;
+	u8* _cursor = nullptr;
+	u8* _end = nullptr;
+
+	std::vector<i64> _owned;
+	std::vector<u8> _removed;
+	std::vector<u32> _freeOwners;
+	u32 _owner = noOwner;
+
+	LuaMemoryStats _stats;
+};
+
+// Makes an owner current for the lifetime of the scope
+class LuaMemoryScope
+{
+public:
+
+	LuaMemoryScope(LuaAllocator& allocator, const u32 owner) :
+		_allocator(allocator),
+		_previous(allocator.GetOwner())
+	{
+		_allocator.SetOwner(owner);
+	}
+
+	~LuaMemoryScope()
+	{
+		_allocator.SetOwner(_previous);
+	}
+
+	LuaMemoryScope(const LuaMemoryScope&) = delete;
+	LuaMemoryScope& operator=(const LuaMemoryScope&) = delete;
+
+private:
+
+	LuaAllocator& _allocator;
+	u32 _previous;
+};
\ No newline at end of file
@@ -2,31 +2,93 @@
 
 #include "Context.h"
 #include "Components.h"
+#include "LuaSystem.h"
+
+#include "ResourceId.h"
 
 #include "Assert.h"
 #include "Lua/MyLua.h"
 #include "Lua/sol/sol.hpp"
 
-LuaManager::LuaManager()
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	// Instructions between count hook calls
+	constexpr u32 hookInterval = 1000;
+
+	// Registry key for the manager owning a state
+	char hookKey;
+
+	// Frames between sweeps for coroutines of destroyed entities that still wait
+	constexpr u32 sweepInterval = 60;
+
+	void OnScriptDestroyed(LuaManager& manager, entt::registry& registry, const entt::entity entity)
+	{
+		manager.ReleaseEntityScript(registry.get<Component::LuaScript>(entity));
+	}
+
+	void OnShardScriptDestroyed(LuaManager& manager, entt::registry& registry, const entt::entity entity)
+	{
+		manager.ReleaseShardScript(entity, registry.get<Component::LuaShardScript>(entity));
+	}
+}
+
+LuaManager::LuaManager() :
+	lua(sol::default_at_panic, LuaAllocator::Allocate, &allocator)
 {
+	profiler.Attach(lua.lua_state());
+
 	lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::string);
 
+	// Opening the jit library is what turns the compiler on, scripts don't get the global
+	lua_State* L = lua.lua_state();
+	lua_pushcfunction(L, luaopen_jit);
+	lua_call(L, 0, 0);
+	_jit = lua["jit"];
+	lua["jit"] = sol::lua_nil;
+
+	// Lets the count hook find the manager from any state or coroutine
+	lua_pushlightuserdata(L, &hookKey);
+	lua_pushlightuserdata(L, this);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+
 	RegisterEngineAPIs();
+	RegisterFfiAPIs();
 }
 
 void LuaManager::Update(const float deltaT)
 {
-	for (auto& [path, script] : _scripts)
+	UpdateHook();
+
+	// Shards run on the workers while the main state updates below
+	const bool sharded = StartShards(deltaT);
+
+	UpdateCoroutines(deltaT);
+
+	for (auto& [path, script] : _updateScripts)
 	{
-		if (script.enabled)
+		if (script->enabled)
 		{
-			Lua::CallFunction(script.environment, "Update", deltaT);
+			LuaProfileScope scope(profiler, *path, LuaProfiler::noEntity, LuaCallback::Update);
+			LuaMemoryScope memory(allocator, script->memoryOwner);
+
+			if (!RunCallback(script->callbacks.update, *path, script->budget, LuaProfiler::noEntity, deltaT) && _overBudget)
+			{
+				script->enabled = false;
+			}
 		}
 	}
 
 	Assert(_context, "Context must be set first");
 
-	auto view = _context->registry.view<Component::LuaScript>();
+	auto view = _context->registry.view<Component::LuaScript, Component::LuaUpdate>();
 	for (auto [entity, script] : view.each())
 	{
 		if (!script.enabled)
@@ -34,101 +96,1962 @@ void LuaManager::Update(const float deltaT)
 			continue;
 		}
 
-		Lua::CallFunction(script.environment, "Update", deltaT);
+		LuaProfileScope scope(profiler, script.path, entt::to_integral(entity), LuaCallback::Update);
+		LuaMemoryScope memory(allocator, script.memoryOwner);
+
+		if (!RunCallback(script.callbacks.update, script.path, script.budget, entt::to_integral(entity), script.environment, deltaT) && _overBudget)
+		{
+			script.enabled = false;
+		}
+	}
+
+	UpdateScriptGroups(deltaT);
+
+	if (sharded)
+	{
+		FinishShards();
 	}
+
+	LogBinary(_context->logger, LogLevel::DEBUG, "Lua tick {}: {} coroutines woke, {} waiting, {} bytes in use",
+		_frameWheel.GetTime(), _dueCoroutines.size(), _timeWheel.GetCount() + _frameWheel.GetCount(), allocator.GetStats().used);
 }
 
 bool LuaManager::LoadScript(const char* path) 
 {
 	LuaScript script;
-	script.environment = Lua::CreateEnvironment(lua, true);
+	script.budget = ResolveBudget(path);
+	script.environment = CreateEnvironment(script.memoryOwner);
 
-	if (!Lua::LoadFile(lua, script.environment, path))
+	if (!LoadScriptFile(script.environment, path, script.memoryOwner))
 	{
+		allocator.RemoveOwner(script.memoryOwner);
+
 		return false;
 	}
 
-	_scripts.emplace(path, script);
+	script.callbacks.Bind(script.environment);
+
+	// Replacing a loaded script releases the old environment
+	auto [it, inserted] = _scripts.try_emplace(path, script);
+	if (!inserted)
+	{
+		const void* environment = it->second.environment.pointer();
+		RemoveSystems([environment](const LuaScriptSystem& system) {
+			return system.owner.environment == environment;
+		});
+
+		allocator.RemoveOwner(it->second.memoryOwner);
+		it->second = script;
+	}
+
+	else
+	{
+		AddScriptUser(path);
+	}
+
+	RebuildUpdateScripts();
 
 	return true;
 }
 
 bool LuaManager::LoadEntityScript(entt::entity& entity, const char* path)
 {
-	Component::LuaScript& script = _context->registry.emplace_or_replace<Component::LuaScript>(entity);
+	// Releases the memory owner of a script being replaced, its coroutines stop with its environment
+	if (_context->registry.remove<Component::LuaScript>(entity))
+	{
+		_sweepCoroutines = true;
+	}
+
+	LuaSharedScript* shared = GetSharedScript(path);
+	if (!shared)
+	{
+		_context->registry.remove<Component::LuaUpdate, Component::LuaBatchUpdate>(entity);
+
+		return false;
+	}
+
+	Component::LuaScript& script = _context->registry.emplace<Component::LuaScript>(entity);
 	script.path = path;
-	script.environment = Lua::CreateEnvironment(lua, true);
+	script.budget = ResolveBudget(path);
+	script.environment = CreateInstance(*shared, script.memoryOwner);
+
+	// Released with the component, also when Start fails below
+	AddScriptUser(script.path);
 
 	Lua::BindObject(script.environment, "Entity", entity);
 
-	if (!Lua::LoadFile(lua, script.environment, path))
-    {
-        _context->registry.remove<Component::LuaScript>(entity);
+	BindEntityCallbacks(entity, script, *shared);
+
+	if (!StartEntityScript(entity, script))
+	{
+		_context->registry.remove<Component::LuaScript, Component::LuaUpdate, Component::LuaBatchUpdate>(entity);
 
-        return false;
-    }
+		return false;
+	}
 
-    return true;
+	return true;
 }
 
 void LuaManager::RemoveScript(const char* path) 
 {
-	_scripts.erase(path);
+	auto it = _scripts.find(path);
+	if (it != _scripts.end())
+	{
+		allocator.RemoveOwner(it->second.memoryOwner);
+		_scripts.erase(it);
+
+		RemoveScriptUser(path);
+
+		RemoveSystems([path](const LuaScriptSystem& system) {
+			return system.owner.entity == LuaProfiler::noEntity && system.owner.path == path;
+		});
+
+		_sweepCoroutines = true;
+	}
+
+	RebuildUpdateScripts();
 }
 
 void LuaManager::RemoveEntityScript(entt::entity& entity) 
 {
-	_context->registry.remove<Component::LuaScript>(entity);
+	_context->registry.remove<Component::LuaScript, Component::LuaUpdate, Component::LuaBatchUpdate, Component::LuaShardScript>(entity);
+
+	_sweepCoroutines = true;
+}
+
+void LuaManager::ReleaseEntityScript(const Component::LuaScript& script)
+{
+	// Systems Start registered for the entity are owned by its instance
+	const void* environment = script.environment.pointer();
+	RemoveSystems([environment](const LuaScriptSystem& system) {
+		return system.owner.environment == environment;
+	});
+
+	allocator.RemoveOwner(script.memoryOwner);
+
+	RemoveScriptUser(script.path);
+}
+
+void LuaManager::ReleaseShardScript(const entt::entity entity, const Component::LuaShardScript& script)
+{
+	_shards[script.shard]->Remove(entity);
+
+	RemoveScriptUser(script.path);
 }
 
 void LuaManager::ReloadScripts() 
 {
+	_prototypes.clear();
+
+	// The chunks run again and start their coroutines and register their systems anew
+	StopCoroutines([this](const LuaCoroutine& coroutine) {
+		return coroutine.owner.entity == LuaProfiler::noEntity && _scripts.contains(coroutine.owner.path);
+	});
+
+	RemoveSystems([this](const LuaScriptSystem& system) {
+		return system.owner.entity == LuaProfiler::noEntity && _scripts.contains(system.owner.path);
+	});
+
 	for (auto& [path, script] : _scripts)
 	{
-		Lua::LoadFile(lua, script.environment, path);
+		LoadScriptFile(script.environment, path, script.memoryOwner);
+
+		script.callbacks.Bind(script.environment);
 	}
+
+	RebuildUpdateScripts();
 }
 
 void LuaManager::RelaodEntityScripts() 
 {
+	_prototypes.clear();
+
+	StopCoroutines([this](const LuaCoroutine& coroutine) {
+		return coroutine.owner.entity != LuaProfiler::noEntity || _sharedScripts.contains(coroutine.owner.path);
+	});
+
+	RemoveSystems([this](const LuaScriptSystem& system) {
+		return system.owner.entity != LuaProfiler::noEntity || _sharedScripts.contains(system.owner.path);
+	});
+
+	// Run again into the same functions, instances and groups keep looking them up there
+	for (auto& [path, shared] : _sharedScripts)
+	{
+		LoadScriptFile(shared.functions, path, shared.memoryOwner);
+
+		shared.callbacks.Bind(shared.functions);
+	}
+
+	for (LuaScriptGroup& group : _scriptGroups)
+	{
+		group.callbacks = _sharedScripts.at(group.path).callbacks;
+	}
+
 	auto view = _context->registry.view<Component::LuaScript>();
 	for (auto [entity, script] : view.each())
 	{
-		Lua::LoadFile(lua, script.environment, script.path);
+		BindEntityCallbacks(entity, script, _sharedScripts.at(script.path));
+		StartEntityScript(entity, script);
+	}
+
+	std::string source;
+	for (auto [entity, script] : _context->registry.view<Component::LuaShardScript>().each())
+	{
+		if (ReadScriptSource(script.path, source))
+		{
+			_shards[script.shard]->Load(entity, script.path, source);
+		}
+	}
+}
+
+void LuaManager::SetHotReload(const bool enabled)
+{
+	_hotReload = enabled;
+
+	if (!enabled)
+	{
+		return;
+	}
+
+	for (const auto& [path, users] : _scriptUsers)
+	{
+		WatchScript(path);
+	}
+}
+
+void LuaManager::ReloadChangedScripts()
+{
+	if (!_hotReload)
+	{
+		return;
+	}
+
+	_changedScripts.clear();
+	_watcher.Poll(_changedScripts);
+
+	for (const std::string& path : _changedScripts)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		const u32 environments = ReloadScript(path);
+
+		const std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+		Log("Reloaded ", path, " into ", environments, " environments in ", time.count(), " ms");
+	}
+}
+
+void LuaManager::SetGarbageBudget(const double time, const u64 memoryCeiling)
+{
+	_garbageTime = time;
+	_garbageCeiling = memoryCeiling;
+	_manualGarbage = true;
+
+	lua_gc(lua.lua_state(), LUA_GCSTOP, 0);
+}
+
+void LuaManager::CollectGarbage(const double slack)
+{
+	lua_State* L = lua.lua_state();
+
+	const auto start = std::chrono::steady_clock::now();
+
+	_garbageStats.steps = 0;
+	bool finished = false;
+
+	if (_manualGarbage)
+	{
+		const u64 heap = u64(lua_gc(L, LUA_GCCOUNT, 0)) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+
+		if (_garbageCeiling && heap > _garbageCeiling)
+		{
+			lua_gc(L, LUA_GCCOLLECT, 0);
+
+			_garbageStats.fullCollections++;
+			_garbageStats.cycles++;
+			_garbageCycle = false;
+			finished = true;
+		}
+
+		else if (_garbageCycle || heap >= _garbageThreshold)
+		{
+			_garbageCycle = true;
+
+			// At least one step a frame so the collector keeps up when there is no slack
+			const std::chrono::duration<double> budget(std::clamp(slack, 0.0, _garbageTime));
+			const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(budget);
+
+			do
+			{
+				_garbageStats.steps++;
+
+				if (lua_gc(L, LUA_GCSTEP, 0))
+				{
+					_garbageStats.cycles++;
+					_garbageCycle = false;
+					finished = true;
+					break;
+				}
+			}
+			while (std::chrono::steady_clock::now() < end);
+		}
+
+		// Steps and full collections reset LuaJIT's threshold, which lets the automatic collector run inside callbacks again
+		lua_gc(L, LUA_GCSTOP, 0);
+	}
+
+	const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+	_garbageStats.time = time.count();
+	_garbageStats.heap = u64(lua_gc(L, LUA_GCCOUNT, 0)) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+
+	if (finished)
+	{
+		_garbageThreshold = _garbageStats.heap * 2;
 	}
+
+	profiler.RecordFrame(_garbageStats.time, _garbageStats.heap);
+}
+
+const LuaGarbageStats& LuaManager::GetGarbageStats() const
+{
+	return _garbageStats;
 }
 
 void LuaManager::SetContext(Context& context)
 {
 	_context = &context;
+
+	_context->registry.on_destroy<Component::LuaScript>().connect<&OnScriptDestroyed>(*this);
+	_context->registry.on_destroy<Component::LuaShardScript>().connect<&OnShardScriptDestroyed>(*this);
 }
 
-void LuaManager::RegisterEngineAPIs()
+void LuaManager::SetShardCount(const u32 count)
 {
-	// Basic types
-	Lua::RegisterType<Vector2f>(lua, "Vector2f",
-		sol::constructors<Vector2f(), Vector2f(float, float)>(),
-		"x", &Vector2f::x,
-		"y", &Vector2f::y);
+	Assert(!_context || _context->registry.storage<Component::LuaShardScript>().empty(), "Shards must be set before loading sharded scripts");
 
+	_shardPool.reset();
+	_shards.clear();
 
-	// Components
-	Lua::RegisterType<Component::Transform>(lua, "Transform",
-		"position", &Component::Transform::position,
-		"velocity", &Component::Transform::velocity,
-		"rotation", &Component::Transform::rotation
-	);
+	for (u32 i = 0; i < count; i++)
+	{
+		_shards.push_back(std::make_unique<LuaShard>());
+	}
 
-	// Ecs
-	Lua::RegisterType<entt::entity>(lua, "Entity",
-		"id", entt::to_integral<entt::entity>
-	);
+	if (count)
+	{
+		_shardPool = std::make_unique<ThreadPool>(count);
+	}
+}
 
-	Lua::RegisterFunction(lua, "GetTransform", [this](entt::entity entity) -> Component::Transform& {
-		return _context->registry.get<Component::Transform>(entity);
-	});
+u32 LuaManager::GetShardCount() const
+{
+	return _shards.size();
+}
 
-	Lua::RegisterFunction(lua, "HasTransform", [this](entt::entity entity) -> bool {
-		return _context->registry.all_of<Component::Transform>(entity);
-	});
+LuaShard& LuaManager::GetShard(const u32 index)
+{
+	Assert(index < _shards.size(), "Invalid lua shard ", index);
+
+	return *_shards[index];
+}
+
+bool LuaManager::LoadShardedEntityScript(entt::entity& entity, const char* path)
+{
+	if (_shards.empty())
+	{
+		return LoadEntityScript(entity, path);
+	}
+
+	RemoveEntityScript(entity);
+
+	std::string source;
+	if (!ReadScriptSource(path, source))
+	{
+		return false;
+	}
+
+	// By entity index so an entity always lands in the same shard
+	const u32 shard = entt::to_entity(entity) % _shards.size();
+	if (!_shards[shard]->Load(entity, path, source))
+	{
+		return false;
+	}
+
+	_context->registry.emplace<Component::LuaShardScript>(entity, path, shard);
+
+	AddScriptUser(path);
+
+	return true;
+}
+
+u64 LuaManager::GetScriptMemory(const char* path) const
+{
+	auto it = _scripts.find(path);
+
+	return it != _scripts.end() ? allocator.GetOwnerMemory(it->second.memoryOwner) : 0;
+}
+
+u64 LuaManager::GetEntityScriptMemory(const entt::entity entity) const
+{
+	Assert(_context, "Context must be set first");
+
+	const Component::LuaScript* script = _context->registry.try_get<Component::LuaScript>(entity);
+
+	return script ? allocator.GetOwnerMemory(script->memoryOwner) : 0;
+}
+
+void LuaManager::SetBytecodeCacheDirectory(const char* directory)
+{
+	_bytecodeDirectory = directory;
+}
+
+bool LuaManager::LoadScriptFile(sol::environment& environment, const std::string& path, const u32 memoryOwner)
+{
+	sol::protected_function* prototype = GetScriptPrototype(path);
+	if (!prototype)
+	{
+		return false;
+	}
+
+	// Functions the chunk defines take the environment it runs in
+	sol::set_environment(environment, *prototype);
+
+	LuaProfileScope scope(profiler, path, LuaProfiler::noEntity, LuaCallback::Load);
+	LuaMemoryScope memory(allocator, memoryOwner);
+
+	const bool result = RunCallback(*prototype, path, ResolveBudget(path), LuaProfiler::noEntity);
+
+	// Back to the globals so the cached chunk doesn't keep the environment alive after its script is removed
+	lua_State* L = lua.lua_state();
+	prototype->push();
+	lua_pushvalue(L, LUA_GLOBALSINDEX);
+	lua_setfenv(L, -2);
+	lua_pop(L, 1);
+
+	return result;
+}
+
+LuaSharedScript* LuaManager::GetSharedScript(const std::string& path)
+{
+	auto it = _sharedScripts.find(path);
+	if (it != _sharedScripts.end())
+	{
+		return &it->second;
+	}
+
+	LuaSharedScript shared;
+	shared.functions = CreateEnvironment(shared.memoryOwner);
+
+	if (!LoadScriptFile(shared.functions, path, shared.memoryOwner))
+	{
+		allocator.RemoveOwner(shared.memoryOwner);
+
+		return nullptr;
+	}
+
+	shared.callbacks.Bind(shared.functions);
+
+	LuaMemoryScope memory(allocator, shared.memoryOwner);
+	shared.metatable = lua.create_table_with("__index", shared.functions);
+
+	return &_sharedScripts.emplace(path, std::move(shared)).first->second;
+}
+
+sol::environment LuaManager::CreateInstance(const LuaSharedScript& shared, u32& memoryOwner)
+{
+	memoryOwner = allocator.AddOwner();
+
+	LuaMemoryScope memory(allocator, memoryOwner);
+
+	sol::environment instance(lua, sol::create);
+	instance[sol::metatable_key] = shared.metatable;
+
+	return instance;
+}
+
+bool LuaManager::StartEntityScript(const entt::entity entity, Component::LuaScript& script)
+{
+	if (!script.callbacks.start.valid())
+	{
+		return true;
+	}
+
+	LuaProfileScope scope(profiler, script.path, entt::to_integral(entity), LuaCallback::Load);
+	LuaMemoryScope memory(allocator, script.memoryOwner);
+
+	return RunCallback(script.callbacks.start, script.path, script.budget, entt::to_integral(entity), script.environment);
+}
+
+sol::protected_function* LuaManager::GetScriptPrototype(const std::string& path)
+{
+	auto it = _prototypes.find(path);
+	if (it != _prototypes.end())
+	{
+		return &it->second;
+	}
+
+	std::string source;
+	if (!ReadScriptSource(path, source))
+	{
+		return nullptr;
+	}
+
+	sol::load_result result = CompileScript(source, path);
+
+	if (!result.valid())
+	{
+		sol::error e = result;
+		LogColor(LOG_YELLOW, "Failed to load lua file ", path, " with error: ", e.what());
+
+		return nullptr;
+	}
+
+	sol::protected_function& prototype = _prototypes.emplace(path, result.get<sol::protected_function>()).first->second;
+	ApplyBudget(path, prototype);
+
+	return &prototype;
+}
+
+bool LuaManager::ReadScriptSource(const std::string& path, std::string& source)
+{
+	Assert(_context, "Context must be set first");
+
+	// Watched files are read from disk, reloads would otherwise get the packed copy back
+	const bool loose = _hotReload && std::filesystem::exists(path);
+
+	const std::string_view code = loose ? std::string_view() : _context->resourceManager.GetPack().FindText(path.c_str());
+	if (!code.empty())
+	{
+		source = code;
+
+		return true;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		LogColor(LOG_YELLOW, "Failed to open lua file ", path);
+
+		return false;
+	}
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	source = stream.str();
+
+	return true;
+}
+
+bool LuaManager::StartShards(const float deltaT)
+{
+	if (!_context || _context->registry.storage<Component::LuaShardScript>().empty())
+	{
+		return false;
+	}
+
+	// Copied so the main state can keep writing transforms while shards read
+	auto& storage = _context->registry.storage<Component::Transform>();
+
+	_snapshot.entities.resize(storage.size());
+	_snapshot.transforms.resize(storage.size());
+	_snapshot.indices.assign(_snapshot.indices.size(), 0);
+
+	u32 position = 0;
+	for (auto [entity, transform] : storage.each())
+	{
+		const u32 index = entt::to_entity(entity);
+		if (index >= _snapshot.indices.size())
+		{
+			_snapshot.indices.resize(index + 1, 0);
+		}
+
+		_snapshot.entities[position] = entity;
+		_snapshot.transforms[position] = transform;
+		_snapshot.indices[index] = ++position;
+	}
+
+	for (std::unique_ptr<LuaShard>& shard : _shards)
+	{
+		if (shard->GetScriptCount())
+		{
+			_shardPool->Push([&shard, this, deltaT]() {
+				shard->Update(deltaT, _snapshot);
+			});
+		}
+	}
+
+	return true;
+}
+
+void LuaManager::FinishShards()
+{
+	_shardPool->Wait();
+
+	// In shard order so the result doesn't depend on which worker finished first
+	entt::registry& registry = _context->registry;
+	for (std::unique_ptr<LuaShard>& shard : _shards)
+	{
+		for (const auto& [entity, transform] : shard->GetCommands().transforms)
+		{
+			if (registry.valid(entity) && registry.all_of<Component::Transform>(entity))
+			{
+				registry.get<Component::Transform>(entity) = transform;
+			}
+		}
+
+		shard->GetCommands().Clear();
+	}
+}
+
+void LuaManager::SetDefaultBudget(const LuaBudget& budget)
+{
+	_defaultBudget = budget;
+
+	for (auto& [path, resolved] : _resolvedBudgets)
+	{
+		resolved = GetBudget(path);
+	}
+
+	UpdateBudgetsLimited();
+
+	for (auto& [path, prototype] : _prototypes)
+	{
+		ApplyBudget(path, prototype);
+	}
+
+	UpdateHook();
+}
+
+void LuaManager::SetScriptBudget(const std::string& path, const LuaBudget& budget)
+{
+	_budgets[path] = budget;
+
+	auto resolved = _resolvedBudgets.find(path);
+	if (resolved != _resolvedBudgets.end())
+	{
+		resolved->second = budget;
+	}
+
+	UpdateBudgetsLimited();
+
+	auto it = _prototypes.find(path);
+	if (it != _prototypes.end())
+	{
+		ApplyBudget(path, it->second);
+	}
+
+	UpdateHook();
+}
+
+const LuaBudget& LuaManager::GetBudget(const std::string& path) const
+{
+	if (_budgets.empty())
+	{
+		return _defaultBudget;
+	}
+
+	auto it = _budgets.find(path);
+
+	return it != _budgets.end() ? it->second : _defaultBudget;
+}
+
+const LuaBudget* LuaManager::ResolveBudget(const std::string& path)
+{
+	auto it = _resolvedBudgets.find(path);
+	if (it == _resolvedBudgets.end())
+	{
+		it = _resolvedBudgets.emplace(path, GetBudget(path)).first;
+	}
+
+	return &it->second;
+}
+
+void LuaManager::UpdateBudgetsLimited()
+{
+	_budgetsLimited = _defaultBudget.IsLimited() || std::any_of(_budgets.begin(), _budgets.end(), [](const auto& pair) {
+		return pair.second.IsLimited();
+	});
+}
+
+void LuaManager::ApplyBudget(const std::string& path, sol::protected_function& prototype)
+{
+	// Recursive so every function the chunk defines follows it
+	sol::protected_function mode = _jit[GetBudget(path).IsLimited() ? "off" : "on"];
+	mode(prototype, true);
+}
+
+void LuaManager::UpdateHook()
+{
+	const bool needed = profiler.IsSampling() || _budgetsLimited;
+
+	if (needed == _hook)
+	{
+		return;
+	}
+
+	lua_sethook(lua.lua_state(), needed ? Hook : nullptr, needed ? LUA_MASKCOUNT : 0, hookInterval);
+	_hook = needed;
+}
+
+void LuaManager::Hook(lua_State* L, lua_Debug*)
+{
+	LuaManager* manager = GetManager(L);
+	if (!manager)
+	{
+		return;
+	}
+
+	manager->profiler.Sample(L, hookInterval);
+
+	const LuaBudget* budget = manager->_running;
+	if (!budget)
+	{
+		return;
+	}
+
+	manager->_runningInstructions += hookInterval;
+
+	const bool instructions = budget->instructions && manager->_runningInstructions > budget->instructions;
+	const bool time = budget->time > 0 && std::chrono::steady_clock::now() > manager->_runningDeadline;
+
+	if (instructions || time)
+	{
+		manager->_overBudget = true;
+		manager->_running = nullptr;
+
+		// Unwinds to the protected call that started the callback
+		luaL_error(L, "Script went over its %s budget", instructions ? "instruction" : "time");
+	}
+}
+
+void LuaManager::ReportOverBudget(const std::string& path, const u32 entity)
+{
+	LogColor(LOG_RED, "Disabled ", path, entity == LuaProfiler::noEntity ? "" : " on entity " + std::to_string(entity), " for going over its budget");
+
+	if (_context)
+	{
+		_context->dispatcher.trigger(Event::ScriptOverBudget{path, entity});
+	}
+}
+
+void LuaManager::DispatchEvents()
+{
+	for (auto& [name, queue] : _eventQueues)
+	{
+		if (queue.subscribers.empty() && !_eventWaits.contains(name))
+		{
+			queue.clear();
+
+			continue;
+		}
+
+		const u32 count = queue.fill(queue);
+		if (!count)
+		{
+			continue;
+		}
+
+		if (_eventWaits.contains(name))
+		{
+			RaiseEvent(name, queue.last());
+		}
+
+		std::erase_if(queue.subscribers, [this](const LuaSubscription& subscription) {
+			return !subscription.function.valid() || !IsOwnerAlive(subscription.owner);
+		});
+
+		// One sample per event type covers the whole fan out
+		LuaProfileScope scope(profiler, name, LuaProfiler::noEntity, LuaCallback::Event);
+
+		for (u32 i = 0; i < queue.subscribers.size(); i++)
+		{
+			// Copied since subscribing from a handler can grow the list
+			const LuaSubscription subscription = queue.subscribers[i];
+			if (!subscription.function.valid())
+			{
+				continue;
+			}
+
+			LuaMemoryScope memory(allocator, subscription.owner.memoryOwner);
+
+			if (!RunCallback(subscription.function, subscription.owner.path, subscription.owner.budget, subscription.owner.entity, queue.events, count) && _overBudget)
+			{
+				queue.subscribers[i].function = sol::protected_function();
+			}
+		}
+
+		queue.clear();
+	}
+}
+
+bool LuaManager::Subscribe(const std::string& name, const sol::protected_function& function)
+{
+	auto it = _eventQueues.find(name);
+	if (it == _eventQueues.end())
+	{
+		LogColor(LOG_YELLOW, "No event named ", name);
+
+		return false;
+	}
+
+	lua_State* L = lua.lua_state();
+
+	LuaSubscription& subscription = it->second.subscribers.emplace_back();
+	subscription.function = function;
+
+	function.push();
+	subscription.owner = GetFunctionOwner(L, -1);
+	lua_pop(L, 1);
+
+	return true;
+}
+
+void LuaManager::Unsubscribe(const std::string& name, const sol::protected_function& function)
+{
+	auto it = _eventQueues.find(name);
+	if (it == _eventQueues.end())
+	{
+		return;
+	}
+
+	// Only cleared here, the next drain removes it so a running fan out isn't disturbed
+	for (LuaSubscription& subscription : it->second.subscribers)
+	{
+		if (subscription.function.valid() && subscription.function.pointer() == function.pointer())
+		{
+			subscription.function = sol::protected_function();
+		}
+	}
+}
+
+void LuaManager::UpdateSystem(const u32 id, const float deltaT)
+{
+	LuaScriptSystem& system = _systems[id];
+	if (!system.update.valid())
+	{
+		return;
+	}
+
+	if (!IsOwnerAlive(system.owner))
+	{
+		system.update = sol::protected_function();
+
+		return;
+	}
+
+	// Prefetched so the script gets its dense arrays without asking for them
+	for (auto& [view, table] : system.queries)
+	{
+		table["count"] = view->fill(*view);
+	}
+
+	_runningSystem = id;
+
+	{
+		LuaProfileScope scope(profiler, system.name, LuaProfiler::noEntity, LuaCallback::System);
+		LuaMemoryScope memory(allocator, system.owner.memoryOwner);
+
+		// Stays in the system manager until its script reloads or goes away
+		if (!RunCallback(system.update, system.owner.path, system.owner.budget, system.owner.entity, deltaT, system.views) && _overBudget)
+		{
+			system.update = sol::protected_function();
+		}
+	}
+
+	_runningSystem = ~0u;
+
+	if (_removeRunningSystem)
+	{
+		_removeRunningSystem = false;
+
+		RemoveSystem(id);
+	}
+}
+
+bool LuaManager::RegisterSystem(const sol::table& definition)
+{
+	Assert(_context, "Context must be set first");
+
+	const std::string name = definition.get_or<std::string>("name", "");
+	sol::object update = definition["update"];
+
+	if (name.empty() || update.get_type() != sol::type::function)
+	{
+		LogColor(LOG_YELLOW, "Lua systems need a name and an update function");
+
+		return false;
+	}
+
+	u32 id;
+	if (!_freeSystems.empty())
+	{
+		id = _freeSystems.back();
+		_freeSystems.pop_back();
+	}
+
+	else
+	{
+		id = _systems.size();
+		_systems.emplace_back();
+	}
+
+	LuaScriptSystem& system = _systems[id];
+	system.name = name;
+	system.update = update.as<sol::protected_function>();
+	system.views = lua.create_table();
+
+	lua_State* L = lua.lua_state();
+	update.push();
+	system.owner = GetFunctionOwner(L, -1);
+	lua_pop(L, 1);
+
+	sol::optional<sol::table> queries = definition["queries"];
+	if (queries)
+	{
+		for (const auto& [key, value] : *queries)
+		{
+			const std::string query = value.as<std::string>();
+
+			LuaComponentView* view = GetComponentView(query);
+			if (!view)
+			{
+				continue;
+			}
+
+			sol::table table = lua.create_table();
+			table["entities"] = view->entities;
+			table["components"] = view->components;
+			table["count"] = 0;
+
+			system.views[query] = table;
+			system.queries.emplace_back(view, table);
+		}
+	}
+
+	const u32 priority = definition.get_or("priority", 0u);
+	const float interval = definition.get_or("interval", 0.0f);
+
+	system.system = &_context->systemManager.AddSystem<LuaSystem>(priority, id, interval);
+
+	return true;
+}
+
+void LuaManager::RemoveSystem(const u32 id)
+{
+	if (id == _runningSystem)
+	{
+		_removeRunningSystem = true;
+
+		return;
+	}
+
+	_context->systemManager.RemoveSystem(_systems[id].system);
+
+	_systems[id] = LuaScriptSystem();
+	_freeSystems.push_back(id);
+}
+
+void LuaManager::RaiseEvent(const std::string& name, const sol::object& payload)
+{
+	auto it = _eventWaits.find(name);
+	if (it == _eventWaits.end())
+	{
+		return;
+	}
+
+	for (const u64 key : it->second)
+	{
+		_eventWakes.emplace_back(key, payload);
+	}
+
+	it->second.clear();
+}
+
+u32 LuaManager::GetCoroutineCount() const
+{
+	return _coroutineIndices.size();
+}
+
+LuaManager* LuaManager::GetManager(lua_State* L)
+{
+	lua_pushlightuserdata(L, &hookKey);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	LuaManager* manager = static_cast<LuaManager*>(lua_touserdata(L, -1));
+	lua_pop(L, 1);
+
+	return manager;
+}
+
+i32 LuaManager::StartCoroutine(lua_State* L)
+{
+	luaL_checktype(L, 1, LUA_TFUNCTION);
+
+	LuaManager& manager = *GetManager(L);
+
+	// The function and its arguments wait on the new thread until the first resume
+	const i32 arguments = lua_gettop(L);
+	lua_State* thread = lua_newthread(L);
+	lua_insert(L, 1);
+	lua_xmove(L, thread, arguments);
+
+	u32 index;
+	if (!manager._freeCoroutines.empty())
+	{
+		index = manager._freeCoroutines.back();
+		manager._freeCoroutines.pop_back();
+	}
+
+	else
+	{
+		index = manager._coroutines.size();
+		manager._coroutines.emplace_back();
+	}
+
+	LuaCoroutine& coroutine = manager._coroutines[index];
+	coroutine.thread = thread;
+	coroutine.reference = luaL_ref(L, LUA_REGISTRYINDEX);
+	coroutine.owner = manager.GetFunctionOwner(thread, 1);
+
+	manager._coroutineIndices.emplace(thread, index);
+
+	// Runs from the next Update
+	coroutine.waiting = true;
+	manager._frameWheel.Schedule(u64(coroutine.generation) << 32 | index, 1);
+
+	return 0;
+}
+
+i32 LuaManager::Wait(lua_State* L)
+{
+	LuaManager& manager = *GetManager(L);
+
+	u64 key;
+	LuaCoroutine* coroutine = manager.GetRunningCoroutine(L, key);
+	if (!coroutine)
+	{
+		return luaL_error(L, "Wait can only be called from a coroutine started with StartCoroutine");
+	}
+
+	const double seconds = luaL_checknumber(L, 1);
+	manager._timeWheel.Schedule(key, u64(std::ceil(std::max(seconds, 0.0) * 1000.0)));
+	coroutine->waiting = true;
+
+	return lua_yield(L, 0);
+}
+
+i32 LuaManager::WaitFrames(lua_State* L)
+{
+	LuaManager& manager = *GetManager(L);
+
+	u64 key;
+	LuaCoroutine* coroutine = manager.GetRunningCoroutine(L, key);
+	if (!coroutine)
+	{
+		return luaL_error(L, "WaitFrames can only be called from a coroutine started with StartCoroutine");
+	}
+
+	const lua_Integer frames = luaL_checkinteger(L, 1);
+	manager._frameWheel.Schedule(key, std::max<lua_Integer>(frames, 1));
+	coroutine->waiting = true;
+
+	return lua_yield(L, 0);
+}
+
+i32 LuaManager::WaitEvent(lua_State* L)
+{
+	LuaManager& manager = *GetManager(L);
+
+	u64 key;
+	LuaCoroutine* coroutine = manager.GetRunningCoroutine(L, key);
+	if (!coroutine)
+	{
+		return luaL_error(L, "WaitEvent can only be called from a coroutine started with StartCoroutine");
+	}
+
+	manager._eventWaits[luaL_checkstring(L, 1)].push_back(key);
+	coroutine->waiting = true;
+
+	return lua_yield(L, 0);
+}
+
+LuaCoroutine* LuaManager::GetRunningCoroutine(lua_State* L, u64& key)
+{
+	auto it = _coroutineIndices.find(L);
+	if (it == _coroutineIndices.end())
+	{
+		return nullptr;
+	}
+
+	LuaCoroutine& coroutine = _coroutines[it->second];
+	key = u64(coroutine.generation) << 32 | it->second;
+
+	return &coroutine;
+}
+
+void LuaManager::UpdateCoroutines(const float deltaT)
+{
+	if (_sweepCoroutines || _frameWheel.GetTime() % sweepInterval == 0)
+	{
+		SweepCoroutines();
+	}
+
+	_coroutineTime += deltaT;
+
+	// Idle coroutines sit in the wheels, advancing only touches the slots coming due
+	_dueCoroutines.clear();
+	_frameWheel.Advance(_frameWheel.GetTime() + 1, _dueCoroutines);
+	_timeWheel.Advance(u64(_coroutineTime * 1000.0), _dueCoroutines);
+
+	for (const u64 key : _dueCoroutines)
+	{
+		ResumeCoroutine(key, sol::object());
+	}
+
+	// Events raised while these run wake their waiters next tick
+	_wakingCoroutines.swap(_eventWakes);
+
+	for (const auto& [key, payload] : _wakingCoroutines)
+	{
+		ResumeCoroutine(key, payload);
+	}
+
+	_wakingCoroutines.clear();
+}
+
+void LuaManager::ResumeCoroutine(const u64 key, const sol::object& payload)
+{
+	const u32 index = u32(key);
+
+	// Finished or stopped since it started waiting
+	LuaCoroutine& coroutine = _coroutines[index];
+	if (!coroutine.thread || coroutine.generation != u32(key >> 32))
+	{
+		return;
+	}
+
+	if (!IsOwnerAlive(coroutine.owner))
+	{
+		ReleaseCoroutine(index);
+
+		return;
+	}
+
+	lua_State* thread = coroutine.thread;
+
+	// The first resume passes the arguments given to StartCoroutine
+	i32 arguments = 0;
+	if (lua_status(thread) != LUA_YIELD)
+	{
+		arguments = lua_gettop(thread) - 1;
+	}
+
+	else if (payload.valid())
+	{
+		payload.push(thread);
+		arguments = 1;
+	}
+
+	coroutine.waiting = false;
+
+	i32 status;
+	{
+		LuaProfileScope scope(profiler, coroutine.owner.path, coroutine.owner.entity, LuaCallback::Coroutine);
+		LuaMemoryScope memory(allocator, coroutine.owner.memoryOwner);
+
+		_overBudget = false;
+		_runningPath = &coroutine.owner.path;
+		_runningBudget = coroutine.owner.budget;
+		_runningEntity = coroutine.owner.entity;
+
+		const LuaBudget& budget = coroutine.owner.budget ? *coroutine.owner.budget : _defaultBudget;
+		if (budget.IsLimited())
+		{
+			_running = &budget;
+			_runningInstructions = 0;
+			_runningDeadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budget.time));
+		}
+
+		status = lua_resume(thread, nullptr, arguments);
+
+		_running = nullptr;
+		_runningPath = nullptr;
+		_runningBudget = nullptr;
+		_runningEntity = LuaProfiler::noEntity;
+	}
+
+	if (status == LUA_YIELD)
+	{
+		lua_settop(thread, 0);
+
+		// A plain coroutine.yield waits a frame
+		if (!coroutine.waiting)
+		{
+			_frameWheel.Schedule(key, 1);
+			coroutine.waiting = true;
+		}
+
+		return;
+	}
+
+	if (status)
+	{
+		LogColor(LOG_YELLOW, "Coroutine of ", coroutine.owner.path, " failed with error: ", lua_tostring(thread, -1));
+
+		if (_overBudget)
+		{
+			ReportOverBudget(coroutine.owner.path, coroutine.owner.entity);
+		}
+	}
+
+	ReleaseCoroutine(index);
+}
+
+void LuaManager::ReleaseCoroutine(const u32 index)
+{
+	LuaCoroutine& coroutine = _coroutines[index];
+
+	luaL_unref(lua.lua_state(), LUA_REGISTRYINDEX, coroutine.reference);
+	_coroutineIndices.erase(coroutine.thread);
+
+	coroutine.thread = nullptr;
+	coroutine.reference = LUA_NOREF;
+	coroutine.owner = LuaScriptOwner();
+	coroutine.generation++;
+
+	_freeCoroutines.push_back(index);
+}
+
+void LuaManager::SweepCoroutines()
+{
+	_sweepCoroutines = false;
+
+	StopCoroutines([this](const LuaCoroutine& coroutine) {
+		return !IsOwnerAlive(coroutine.owner);
+	});
+
+	for (auto& [name, keys] : _eventWaits)
+	{
+		std::erase_if(keys, [this](const u64 key) {
+			const LuaCoroutine& coroutine = _coroutines[u32(key)];
+
+			return !coroutine.thread || coroutine.generation != u32(key >> 32);
+		});
+	}
+}
+
+LuaScriptOwner LuaManager::GetFunctionOwner(lua_State* L, const i32 index) const
+{
+	LuaScriptOwner owner;
+	owner.path = _runningPath ? *_runningPath : "";
+	owner.memoryOwner = allocator.GetOwner();
+	owner.budget = _runningBudget;
+
+	// Entity scripts share their functions, what they hand over belongs to the instance they run for
+	if (_runningEntity != LuaProfiler::noEntity)
+	{
+		Assert(_context, "Context must be set first");
+
+		const Component::LuaScript* script = _context->registry.try_get<Component::LuaScript>(entt::entity{_runningEntity});
+		owner.entity = _runningEntity;
+		owner.environment = script ? script->environment.pointer() : nullptr;
+
+		return owner;
+	}
+
+	// Functions keep the environment of the script that defined them, entity scripts bind their entity there
+	lua_getfenv(L, index);
+	owner.environment = lua_topointer(L, -1);
+
+	sol::table environment(L, -1);
+	sol::object entity = environment.raw_get<sol::object>("Entity");
+	owner.entity = entity.is<entt::entity>() ? entt::to_integral(entity.as<entt::entity>()) : LuaProfiler::noEntity;
+
+	lua_pop(L, 1);
+
+	return owner;
+}
+
+bool LuaManager::IsOwnerAlive(const LuaScriptOwner& owner) const
+{
+	if (owner.entity != LuaProfiler::noEntity)
+	{
+		Assert(_context, "Context must be set first");
+
+		const entt::entity entity{owner.entity};
+		if (!_context->registry.valid(entity))
+		{
+			return false;
+		}
+
+		const Component::LuaScript* script = _context->registry.try_get<Component::LuaScript>(entity);
+
+		return script && script->environment.pointer() == owner.environment;
+	}
+
+	// Handed over outside of any script
+	if (owner.path.empty())
+	{
+		return true;
+	}
+
+	auto script = _scripts.find(owner.path);
+	if (script != _scripts.end() && script->second.environment.pointer() == owner.environment)
+	{
+		return true;
+	}
+
+	// Run by an entity script's chunk or by its group's UpdateAll
+	auto shared = _sharedScripts.find(owner.path);
+
+	return shared != _sharedScripts.end() && shared->second.functions.pointer() == owner.environment;
+}
+
+sol::load_result LuaManager::CompileScript(const std::string_view code, const std::string& path)
+{
+	const u64 hash = ResourceId::Hash(code);
+
+	// A changed source replaces the path's previous chunk
+	LuaBytecode& bytecode = _bytecode[path];
+	if (bytecode.hash != hash)
+	{
+		bytecode.hash = hash;
+		bytecode.code.clear();
+
+		ReadBytecodeFile(path, hash, bytecode.code);
+	}
+
+	if (!bytecode.code.empty())
+	{
+		sol::load_result result = lua.load(bytecode.code, "@" + path, sol::load_mode::binary);
+		if (result.valid())
+		{
+			return result;
+		}
+
+		// Written by a different LuaJIT build, compile it again
+		bytecode.code.clear();
+	}
+
+	sol::load_result result = lua.load(code, "@" + path, sol::load_mode::text);
+	if (!result.valid())
+	{
+		return result;
+	}
+
+	lua_State* L = lua.lua_state();
+
+	const lua_Writer writer = [](lua_State*, const void* data, size_t size, void* user) -> int {
+		static_cast<std::string*>(user)->append(static_cast<const char*>(data), size);
+		return 0;
+	};
+
+	sol::protected_function chunk = result;
+	chunk.push();
+	const int error = lua_dump(L, writer, &bytecode.code, 0);
+	lua_pop(L, 1);
+
+	if (error)
+	{
+		bytecode.code.clear();
+	}
+	else
+	{
+		WriteBytecodeFile(path, hash, bytecode.code);
+	}
+
+	return result;
+}
+
+bool LuaManager::ReadBytecodeFile(const std::string& path, const u64 hash, std::string& bytecode)
+{
+	if (_bytecodeDirectory.empty())
+	{
+		return false;
+	}
+
+	std::ifstream file(GetBytecodeFile(path, hash), std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	bytecode = stream.str();
+
+	return !bytecode.empty();
+}
+
+void LuaManager::WriteBytecodeFile(const std::string& path, const u64 hash, const std::string& bytecode)
+{
+	if (_bytecodeDirectory.empty())
+	{
+		return;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(_bytecodeDirectory, error);
+
+	// Chunks of the path's older sources, from this run or an earlier one
+	const std::string prefix = std::to_string(ResourceId::Hash(path)) + "_";
+	for (const auto& entry : std::filesystem::directory_iterator(_bytecodeDirectory, error))
+	{
+		const std::string name = entry.path().filename().string();
+		if (name.starts_with(prefix) && entry.path().extension() == ".luac")
+		{
+			std::filesystem::remove(entry.path(), error);
+		}
+	}
+
+	std::ofstream file(GetBytecodeFile(path, hash), std::ios::binary);
+	if (!file.write(bytecode.data(), bytecode.size()))
+	{
+		LogColor(LOG_YELLOW, "Failed to write lua bytecode for ", path);
+	}
+}
+
+std::filesystem::path LuaManager::GetBytecodeFile(const std::string& path, const u64 hash) const
+{
+	// Named by path and source so one path only ever has one file
+	return std::filesystem::path(_bytecodeDirectory) / (std::to_string(ResourceId::Hash(path)) + "_" + std::to_string(hash) + ".luac");
+}
+
+u32 LuaManager::ReloadScript(const std::string& path)
+{
+	_prototypes.erase(path);
+
+	StopCoroutines([&path](const LuaCoroutine& coroutine) {
+		return coroutine.owner.path == path;
+	});
+
+	RemoveSystems([&path](const LuaScriptSystem& system) {
+		return system.owner.path == path;
+	});
+
+	u32 environments = 0;
+
+	// Reloading gives scripts disabled for going over their budget another chance
+	auto script = _scripts.find(path);
+	if (script != _scripts.end())
+	{
+		if (LoadScriptFile(script->second.environment, path, script->second.memoryOwner))
+		{
+			script->second.enabled = true;
+		}
+
+		script->second.callbacks.Bind(script->second.environment);
+
+		RebuildUpdateScripts();
+		environments++;
+	}
+
+	auto shared = _sharedScripts.find(path);
+	if (shared != _sharedScripts.end())
+	{
+		LuaSharedScript& sharedScript = shared->second;
+
+		const bool loaded = LoadScriptFile(sharedScript.functions, path, sharedScript.memoryOwner);
+		sharedScript.callbacks.Bind(sharedScript.functions);
+		environments++;
+
+		auto group = _scriptGroupIndices.find(path);
+		if (group != _scriptGroupIndices.end())
+		{
+			_scriptGroups[group->second].callbacks = sharedScript.callbacks;
+		}
+
+		Assert(_context, "Context must be set first");
+
+		// Instances keep their fields, Start runs again to register what the reload stopped
+		auto view = _context->registry.view<Component::LuaScript>();
+		for (auto [entity, entityScript] : view.each())
+		{
+			if (entityScript.path == path)
+			{
+				BindEntityCallbacks(entity, entityScript, sharedScript);
+
+				if (StartEntityScript(entity, entityScript) && loaded)
+				{
+					entityScript.enabled = true;
+				}
+
+				environments++;
+			}
+		}
+	}
+
+	std::string source;
+	if (!_shards.empty() && ReadScriptSource(path, source))
+	{
+		for (std::unique_ptr<LuaShard>& shard : _shards)
+		{
+			environments += shard->Reload(path, source);
+		}
+	}
+
+	return environments;
+}
+
+void LuaManager::WatchScript(const std::string& path)
+{
+	// Scripts read from the asset pack have no file to watch
+	if (_hotReload && !_watcher.IsWatching(path) && std::filesystem::exists(path))
+	{
+		_watcher.Watch(path);
+	}
+}
+
+void LuaManager::AddScriptUser(const std::string& path)
+{
+	_scriptUsers[path]++;
+
+	WatchScript(path);
+}
+
+void LuaManager::RemoveScriptUser(const std::string& path)
+{
+	auto it = _scriptUsers.find(path);
+	if (it == _scriptUsers.end() || --it->second)
+	{
+		return;
+	}
+
+	_scriptUsers.erase(it);
+	_watcher.Unwatch(path);
+}
+
+sol::environment LuaManager::CreateEnvironment(u32& memoryOwner)
+{
+	memoryOwner = allocator.AddOwner();
+
+	LuaMemoryScope memory(allocator, memoryOwner);
+
+	return Lua::CreateEnvironment(lua, true);
+}
+
+void LuaManager::BindEntityCallbacks(const entt::entity entity, Component::LuaScript& script, const LuaSharedScript& shared)
+{
+	script.callbacks = shared.callbacks;
+
+	entt::registry& registry = _context->registry;
+	registry.remove<Component::LuaUpdate, Component::LuaBatchUpdate>(entity);
+
+	if (script.callbacks.HasUpdateAll())
+	{
+		registry.emplace<Component::LuaBatchUpdate>(entity, GetScriptGroup(script.path, shared));
+	}
+
+	else if (script.callbacks.HasUpdate())
+	{
+		registry.emplace<Component::LuaUpdate>(entity);
+	}
+}
+
+void LuaManager::RebuildUpdateScripts()
+{
+	_updateScripts.clear();
+
+	for (auto& [path, script] : _scripts)
+	{
+		if (script.callbacks.HasUpdate())
+		{
+			_updateScripts.emplace_back(&path, &script);
+		}
+	}
+
+	// By path rather than hash map order so runs are repeatable
+	std::sort(_updateScripts.begin(), _updateScripts.end(), [](const auto& a, const auto& b) {
+		return *a.first < *b.first;
+	});
+}
+
+u32 LuaManager::GetScriptGroup(const std::string& path, const LuaSharedScript& shared)
+{
+	auto it = _scriptGroupIndices.find(path);
+	if (it != _scriptGroupIndices.end())
+	{
+		return it->second;
+	}
+
+	LuaScriptGroup& group = _scriptGroups.emplace_back();
+	group.path = path;
+	group.budget = ResolveBudget(path);
+	group.environment = shared.functions;
+	group.callbacks = shared.callbacks;
+	group.memoryOwner = shared.memoryOwner;
+	group.entities = lua.create_table();
+
+	const u32 index = _scriptGroups.size() - 1;
+	_scriptGroupIndices.emplace(path, index);
+
+	return index;
+}
+
+void LuaManager::UpdateScriptGroups(const float deltaT)
+{
+	if (_scriptGroups.empty())
+	{
+		return;
+	}
+
+	for (LuaScriptGroup& group : _scriptGroups)
+	{
+		group.members.clear();
+	}
+
+	auto view = _context->registry.view<Component::LuaScript, Component::LuaBatchUpdate>();
+	for (auto [entity, script, batch] : view.each())
+	{
+		if (script.enabled)
+		{
+			_scriptGroups[batch.group].members.push_back(entity);
+		}
+	}
+
+	lua_State* L = lua.lua_state();
+
+	for (LuaScriptGroup& group : _scriptGroups)
+	{
+		if (group.members.empty() || !group.callbacks.HasUpdateAll())
+		{
+			continue;
+		}
+
+		// Fill the reused array in place, clearing whatever is left from a larger previous tick
+		group.entities.push();
+
+		const u32 count = group.members.size();
+		for (u32 i = 0; i < count; i++)
+		{
+			lua_pushinteger(L, entt::to_integral(group.members[i]));
+			lua_rawseti(L, -2, i + 1);
+		}
+
+		for (u32 i = count; i < group.entityCount; i++)
+		{
+			lua_pushnil(L);
+			lua_rawseti(L, -2, i + 1);
+		}
+
+		lua_pop(L, 1);
+
+		group.entityCount = count;
+
+		LuaProfileScope scope(profiler, group.path, LuaProfiler::noEntity, LuaCallback::UpdateAll);
+		LuaMemoryScope memory(allocator, group.memoryOwner);
+
+		// Dropping the callback stops the whole group, members keep their own enabled flag
+		if (!RunCallback(group.callbacks.updateAll, group.path, group.budget, LuaProfiler::noEntity, group.entities, deltaT) && _overBudget)
+		{
+			group.callbacks.updateAll = sol::protected_function();
+		}
+	}
+}
+
+void LuaManager::RegisterEngineTypes(sol::state& lua)
+{
+	// Basic types
+	Lua::RegisterType<Vector2f>(lua, "Vector2f",
+		sol::constructors<Vector2f(), Vector2f(float, float)>(),
+		"x", &Vector2f::x,
+		"y", &Vector2f::y);
+
+	Lua::RegisterType<Vector2i>(lua, "Vector2i",
+		sol::constructors<Vector2i(), Vector2i(i32, i32)>(),
+		"x", &Vector2i::x,
+		"y", &Vector2i::y);
+
+
+	// Components
+	Lua::RegisterType<Component::Transform>(lua, "Transform",
+		"position", &Component::Transform::position,
+		"velocity", &Component::Transform::velocity,
+		"rotation", &Component::Transform::rotation
+	);
+
+	// Ecs
+	Lua::RegisterType<entt::entity>(lua, "Entity",
+		"id", entt::to_integral<entt::entity>
+	);
+}
+
+void LuaManager::RegisterEngineAPIs()
+{
+	RegisterEngineTypes(lua);
+
+	Lua::RegisterFunction(lua, "GetTransform", [this](entt::entity entity) -> Component::Transform& {
+		return _context->registry.get<Component::Transform>(entity);
+	});
+
+	Lua::RegisterFunction(lua, "HasTransform", [this](entt::entity entity) -> bool {
+		return _context->registry.all_of<Component::Transform>(entity);
+	});
+
+	// Same as in the shards, where writing through GetTransform has no effect
+	Lua::RegisterFunction(lua, "SetTransform", [this](entt::entity entity, const Component::Transform& transform) {
+		_context->registry.get<Component::Transform>(entity) = transform;
+	});
+
+	// Coroutines
+	lua_State* L = lua.lua_state();
+	lua_register(L, "StartCoroutine", StartCoroutine);
+	lua_register(L, "Wait", Wait);
+	lua_register(L, "WaitFrames", WaitFrames);
+	lua_register(L, "WaitEvent", WaitEvent);
+
+	Lua::RegisterFunction(lua, "RaiseEvent", [this](const std::string& name, const sol::object& payload) {
+		RaiseEvent(name, payload);
+	});
+
+	// Systems ordered with the c++ ones by priority
+	Lua::RegisterFunction(lua, "RegisterSystem", [this](const sol::table& definition) -> bool {
+		return RegisterSystem(definition);
+	});
+
+	// Dispatcher events, the handler gets the batch and its size, Subscribe("FoodEaten", function(events, count) ... end)
+	Lua::RegisterFunction(lua, "Subscribe", [this](const std::string& name, const sol::protected_function& function) -> bool {
+		return Subscribe(name, function);
+	});
+
+	Lua::RegisterFunction(lua, "Unsubscribe", [this](const std::string& name, const sol::protected_function& function) {
+		Unsubscribe(name, function);
+	});
+
+	// Bulk views
+	RegisterComponentView<Component::Transform>("Transform");
+
+	Lua::RegisterFunction(lua, "ForEach", [this](const std::string& name, const sol::protected_function& function) -> bool {
+		LuaComponentView* view = GetComponentView(name);
+
+		return view && view->forEach(function);
+	});
+
+	// Returns the entity ids, their components and the count, the tables are reused by the next call
+	Lua::RegisterFunction(lua, "GetComponents", [this](const std::string& name) -> std::tuple<sol::object, sol::object, u32> {
+		LuaComponentView* view = GetComponentView(name);
+		if (!view)
+		{
+			return {sol::lua_nil, sol::lua_nil, 0};
+		}
+
+		const u32 count = view->fill(*view);
+
+		return {view->entities, view->components, count};
+	});
+}
+
+template<typename T>
+void LuaManager::RegisterComponentView(const std::string& name)
+{
+	LuaComponentView& componentView = _componentViews[name];
+	componentView.entities = lua.create_table();
+	componentView.components = lua.create_table();
+
+	componentView.forEach = [this, name](const sol::protected_function& function) -> bool
+	{
+		lua_State* L = lua.lua_state();
+
+		for (auto [entity, component] : _context->registry.view<T>().each())
+		{
+			function.push();
+			lua_pushinteger(L, entt::to_integral(entity));
+			sol::stack::push(L, &component);
+
+			if (lua_pcall(L, 2, 0, 0))
+			{
+				LogColor(LOG_YELLOW, "Invalid call of ForEach ", name, " with error: ", lua_tostring(L, -1));
+				lua_pop(L, 1);
+
+				return false;
+			}
+		}
+
+		return true;
+	};
+
+	componentView.address = [this](const entt::entity entity) -> void*
+	{
+		return _context->registry.try_get<T>(entity);
+	};
+
+	componentView.storage = [this]() -> std::tuple<void*, const void*, u32>
+	{
+		auto& storage = _context->registry.storage<T>();
+
+		return {storage.raw(), storage.data(), storage.size()};
+	};
+
+	componentView.pageSize = entt::component_traits<T>::page_size;
+
+	componentView.fill = [this](LuaComponentView& view) -> u32
+	{
+		lua_State* L = lua.lua_state();
+
+		view.entities.push();
+		view.components.push();
+
+		u32 count = 0;
+		for (auto [entity, component] : _context->registry.view<T>().each())
+		{
+			count++;
+
+			lua_pushinteger(L, entt::to_integral(entity));
+			lua_rawseti(L, -3, count);
+
+			sol::stack::push(L, &component);
+			lua_rawseti(L, -2, count);
+		}
+
+		// Clear whatever is left from a larger previous call
+		for (u32 i = count + 1; i <= view.count; i++)
+		{
+			lua_pushnil(L);
+			lua_rawseti(L, -3, i);
+
+			lua_pushnil(L);
+			lua_rawseti(L, -2, i);
+		}
+
+		lua_pop(L, 2);
+
+		view.count = count;
+
+		return count;
+	};
+}
+
+// Must match the c declarations below
+static_assert(sizeof(Vector2f) == 2 * sizeof(float));
+static_assert(offsetof(Component::Transform, velocity) == sizeof(Vector2f));
+static_assert(offsetof(Component::Transform, rotation) == 2 * sizeof(Vector2f));
+
+static constexpr const char* ffiAPI = R"lua(
+local ffi, views = ...
+
+ffi.cdef[[
+typedef struct Vector2f { float x, y; } Vector2f;
+typedef struct Transform { Vector2f position; Vector2f velocity; float rotation; } Transform;
+]]
+
+local Vector2f = ffi.typeof("Vector2f")
+local sqrt = math.sqrt
+local floor = math.floor
+
+ffi.metatype(Vector2f, {
+	__add = function(a, b) return Vector2f(a.x + b.x, a.y + b.y) end,
+	__sub = function(a, b) return Vector2f(a.x - b.x, a.y - b.y) end,
+	__mul = function(a, b)
+		if type(a) == "number" then return Vector2f(a * b.x, a * b.y) end
+		if type(b) == "number" then return Vector2f(a.x * b, a.y * b) end
+		return Vector2f(a.x * b.x, a.y * b.y)
+	end,
+	__div = function(a, b) return Vector2f(a.x / b, a.y / b) end,
+	__unm = function(a) return Vector2f(-a.x, -a.y) end,
+	__tostring = function(a) return "(" .. a.x .. ", " .. a.y .. ")" end,
+	__index = {
+		Length = function(a) return sqrt(a.x * a.x + a.y * a.y) end,
+		Dot = function(a, b) return a.x * b.x + a.y * b.y end,
+		Normalized = function(a)
+			local length = sqrt(a.x * a.x + a.y * a.y)
+			if length == 0 then return Vector2f(0, 0) end
+			return Vector2f(a.x / length, a.y / length)
+		end,
+	},
+})
+
+local pointers = {}
+local pages = {}
+for name in pairs(views.names) do
+	pointers[name] = ffi.typeof(name .. "*")
+	pages[name] = ffi.typeof(name .. "**")
+end
+
+local entityPointer = ffi.typeof("const uint32_t*")
+
+Ffi = {}
+Ffi.Vector2f = Vector2f
+
+-- Pointer to the entity's component or nil, don't keep it past the current call
+function Ffi.Get(name, entity)
+	local address = views.address(name, entity)
+	if address then
+		return ffi.cast(pointers[name], address)
+	end
+end
+
+-- for entity, component in Ffi.Each("Transform") do ... end
+function Ffi.Each(name)
+	local storage, entities, count, pageSize = views.storage(name)
+	storage = ffi.cast(pages[name], storage)
+	entities = ffi.cast(entityPointer, entities)
+
+	local i = -1
+	return function()
+		i = i + 1
+		if i < count then
+			local page = floor(i / pageSize)
+			return entities[i], storage[page] + (i - page * pageSize)
+		end
+	end
+end
+)lua";
+
+void LuaManager::RegisterFfiAPIs()
+{
+	lua_State* L = lua.lua_state();
+
+	// Opened without a global so scripts only get the typed wrappers, not raw ffi
+	lua_pushcfunction(L, luaopen_ffi);
+	lua_call(L, 0, 1);
+	sol::table ffi(L, -1);
+	lua_pop(L, 1);
+
+	sol::table views = lua.create_table();
+	sol::table names = lua.create_table();
+	for (const auto& [name, view] : _componentViews)
+	{
+		names[name] = true;
+	}
+
+	views["names"] = names;
+
+	// Nil rather than a null light userdata, which would be truthy
+	views["address"] = [this](const std::string& name, entt::entity entity) -> sol::object {
+		LuaComponentView* view = GetComponentView(name);
+
+		void* address = view ? view->address(entity) : nullptr;
+		if (!address)
+		{
+			return sol::lua_nil;
+		}
+
+		return sol::make_object(lua, sol::lightuserdata_value(address));
+	};
+
+	views["storage"] = [this](const std::string& name) -> std::tuple<void*, const void*, u32, u32> {
+		LuaComponentView* view = GetComponentView(name);
+		if (!view)
+		{
+			return {nullptr, nullptr, 0, 1};
+		}
+
+		auto [pages, entities, count] = view->storage();
+
+		return {pages, entities, count, view->pageSize};
+	};
+
+	sol::protected_function api = lua.load(ffiAPI, "=ffi");
+	Lua::Call(api, "ffi", ffi, views);
+}
+
+LuaComponentView* LuaManager::GetComponentView(const std::string& name)
+{
+	auto it = _componentViews.find(name);
+	if (it == _componentViews.end())
+	{
+		LogColor(LOG_YELLOW, "No component view named ", name);
+
+		return nullptr;
+	}
+
+	return &it->second;
 }
\ No newline at end of file
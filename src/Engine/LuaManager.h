@@ -2,6 +2,7 @@
 
 // Forward
 struct Context;
+class System;
 #include <cstdint> 
 namespace entt
 {
@@ -9,14 +10,172 @@ namespace entt
 }
 
 #include "Lua/MyLua.h"
+#include "Components.h"
+#include "FileWatcher.h"
+#include "LuaAllocator.h"
+#include "LuaProfiler.h"
+#include "LuaShard.h"
+#include "ThreadPool.h"
+#include "TimerWheel.h"
 
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 struct LuaScript
 {
 	sol::environment environment;
+	LuaCallbacks callbacks;
 	bool enabled = true;
+
+	u32 memoryOwner = LuaAllocator::noOwner;
+	const LuaBudget* budget = nullptr;
+};
+
+// An entity script's chunk, run once per path. Instances look up what they don't hold here, callbacks get the instance as self
+struct LuaSharedScript
+{
+	sol::environment functions;
+	LuaCallbacks callbacks;
+
+	// Set on every instance, its __index is the functions
+	sol::table metatable;
+	u32 memoryOwner = LuaAllocator::noOwner;
+};
+
+// Entities sharing a script path whose script defines UpdateAll
+struct LuaScriptGroup
+{
+	std::string path;
+
+	// The path's shared functions, UpdateAll comes from here
+	sol::environment environment;
+	LuaCallbacks callbacks;
+	u32 memoryOwner = LuaAllocator::noOwner;
+	const LuaBudget* budget = nullptr;
+
+	// Entity ids handed to UpdateAll, reused every tick
+	sol::table entities;
+	u32 entityCount = 0;
+
+	std::vector<entt::entity> members;
+};
+
+// A path's dumped chunk and the hash of the source it was compiled from
+struct LuaBytecode
+{
+	u64 hash = 0;
+	std::string code;
+};
+
+// Limits for a single callback, zero means unlimited
+struct LuaBudget
+{
+	u64 instructions = 0;
+	double time = 0;
+
+	bool IsLimited() const
+	{
+		return instructions || time > 0;
+	}
+};
+
+struct LuaGarbageStats
+{
+	// Spent collecting during the last frame
+	double time = 0;
+	u32 steps = 0;
+
+	u64 heap = 0;
+	u64 cycles = 0;
+	u64 fullCollections = 0;
+};
+
+// The script a lua function came from, whatever holds the function stops with that script's environment
+struct LuaScriptOwner
+{
+	std::string path;
+	u32 entity = LuaProfiler::noEntity;
+	const void* environment = nullptr;
+	u32 memoryOwner = LuaAllocator::noOwner;
+	const LuaBudget* budget = nullptr;
+};
+
+// Started by StartCoroutine from lua, resumed by the scheduler once what it waits for happened
+struct LuaCoroutine
+{
+	lua_State* thread = nullptr;
+	i32 reference = LUA_NOREF;
+
+	LuaScriptOwner owner;
+
+	// Bumped when it finishes so timers and event waits still holding it are skipped
+	u32 generation = 0;
+	bool waiting = false;
+};
+
+struct LuaSubscription
+{
+	sol::protected_function function;
+	LuaScriptOwner owner;
+};
+
+// Dispatcher events of one type, collected while the dispatcher drains and handed to every lua subscriber in one call
+struct LuaEventQueue
+{
+	// Refills events with copies of the collected events and returns how many there are
+	std::function<u32 (LuaEventQueue& queue)> fill;
+
+	// A copy of the newest event for coroutines waiting on it
+	std::function<sol::object ()> last;
+	std::function<void ()> clear;
+
+	std::vector<LuaSubscription> subscribers;
+
+	// Reused between drains, entries past count are nil
+	sol::table events;
+	u32 count = 0;
+};
+
+// Bulk access to every entity holding one component type, a whole view per call from lua
+struct LuaComponentView
+{
+	// Calls the function with each entity id and a reference to its component
+	std::function<bool (const sol::protected_function& function)> forEach;
+
+	// Refills the dense arrays below and returns how many entries they hold
+	std::function<u32 (LuaComponentView& view)> fill;
+
+	// Addresses for the ffi layer, only valid until the storage changes
+	std::function<void* (const entt::entity entity)> address;
+
+	// The storage's page array, its packed entity array and its size
+	std::function<std::tuple<void*, const void*, u32> ()> storage;
+	u32 pageSize = 0;
+
+	// Reused between calls, entries past count are nil
+	sol::table entities;
+	sol::table components;
+	u32 count = 0;
+};
+
+// Registered by a script with RegisterSystem, runs through a LuaSystem in the SystemManager
+struct LuaScriptSystem
+{
+	std::string name;
+	sol::protected_function update;
+	LuaScriptOwner owner;
+
+	// Refilled before every run and handed over as views[name] = {entities, components, count}
+	std::vector<std::pair<LuaComponentView*, sol::table>> queries;
+	sol::table views;
+
+	System* system = nullptr;
 };
 
 class LuaManager
@@ -33,22 +192,343 @@ public:
 	void RemoveScript(const char* path);
 	void RemoveEntityScript(entt::entity& entity);
 
+	// Releases what an entity script owns once its component goes away, however it was removed
+	void ReleaseEntityScript(const Component::LuaScript& script);
+	void ReleaseShardScript(const entt::entity entity, const Component::LuaShardScript& script);
+
 	void ReloadScripts();
 	void RelaodEntityScripts();
 
+	// Watches the files of loaded scripts, changes are applied by ReloadChangedScripts
+	void SetHotReload(const bool enabled);
+
+	// Scripts going over their budget are stopped and disabled until reloaded, budgeted scripts run without the jit
+	void SetDefaultBudget(const LuaBudget& budget);
+	void SetScriptBudget(const std::string& path, const LuaBudget& budget);
+
+	// Stops the automatic collector, CollectGarbage then steps it within the time budget and collects fully above the ceiling
+	void SetGarbageBudget(const double time, const u64 memoryCeiling);
+
+	// Call once per frame after rendering with the time left before the frame is due
+	void CollectGarbage(const double slack);
+	const LuaGarbageStats& GetGarbageStats() const;
+
+	// Live bytes allocated while the script's environment was running
+	u64 GetScriptMemory(const char* path) const;
+	u64 GetEntityScriptMemory(const entt::entity entity) const;
+
+	// Bridges a dispatcher event to lua under name, the arguments are its usertype members. Defined in Context.h where the dispatcher is known
+	template<typename T, typename... Args>
+	void RegisterEvent(const std::string& name, Args&&... members);
+
+	// Call after the dispatcher's update, subscribers get each type's events of the batch in one call
+	void DispatchEvents();
+
+	// Called by the script's LuaSystem when it is due
+	void UpdateSystem(const u32 id, const float deltaT);
+
+	// Wakes the coroutines waiting on the event on the next Update, WaitEvent returns the payload
+	void RaiseEvent(const std::string& name, const sol::object& payload = sol::object());
+	u32 GetCoroutineCount() const;
+
+	// Recompiles only the scripts whose files changed and rebinds everything using them, call between frames
+	void ReloadChangedScripts();
+
 	void SetContext(Context& context);
 
+	// Runs sharded entity scripts in count independent states on worker threads alongside the main state's Update, set before loading any
+	void SetShardCount(const u32 count);
+	u32 GetShardCount() const;
+	LuaShard& GetShard(const u32 index);
+
+	// Sharded scripts get the engine types and transform functions but no coroutines, events or ffi. GetTransform returns a copy from the start of the tick and SetTransform is applied after it
+	bool LoadShardedEntityScript(entt::entity& entity, const char* path);
+
+	// The only state shared between shards, plain values copied into every state between ticks. Writes from scripts stay in their own state
+	template<typename T>
+	void SetSharedGlobal(const std::string& name, const T& value)
+	{
+		static_assert(std::is_arithmetic_v<T> || std::is_convertible_v<T, std::string_view>, "Only plain values can be shared between lua states");
+
+		lua[name] = value;
+
+		for (std::unique_ptr<LuaShard>& shard : _shards)
+		{
+			shard->lua[name] = value;
+		}
+	}
+
+	// The usertypes every state gets
+	static void RegisterEngineTypes(sol::state& lua);
+
+	// Bytecode is also written here and read back on the next run, empty keeps it in memory only
+	void SetBytecodeCacheDirectory(const char* directory);
+
 public:
 
+	// Declared before the state, which allocates through it until closed
+	LuaAllocator allocator;
+
 	sol::state lua;
 
+	// Declared after the state so its allocator is restored before the state closes
+	LuaProfiler profiler;
+
 private:
 
 	void RegisterEngineAPIs();
 
+	// Declares the components as c types and exposes typed pointers into their storage
+	void RegisterFfiAPIs();
+
+	template<typename T>
+	void RegisterComponentView(const std::string& name);
+	LuaComponentView* GetComponentView(const std::string& name);
+
+	// Runs the script's shared prototype in the environment
+	bool LoadScriptFile(sol::environment& environment, const std::string& path, const u32 memoryOwner);
+
+	// Charged to a new memory owner
+	sol::environment CreateEnvironment(u32& memoryOwner);
+
+	// Runs an entity script's chunk the first time its path is loaded
+	LuaSharedScript* GetSharedScript(const std::string& path);
+	sol::environment CreateInstance(const LuaSharedScript& shared, u32& memoryOwner);
+	bool StartEntityScript(const entt::entity entity, Component::LuaScript& script);
+
+	// Compiled once per path, reads from the mounted asset pack when it holds the script
+	sol::protected_function* GetScriptPrototype(const std::string& path);
+	bool ReadScriptSource(const std::string& path, std::string& source);
+
+	// Snapshots the components shards read and hands each shard to a worker, returns false when no shard has scripts
+	bool StartShards(const float deltaT);
+	void FinishShards();
+
+	// Loads the bytecode of an unchanged source, otherwise compiles it and stores the bytecode
+	sol::load_result CompileScript(const std::string_view code, const std::string& path);
+	bool ReadBytecodeFile(const std::string& path, const u64 hash, std::string& bytecode);
+	void WriteBytecodeFile(const std::string& path, const u64 hash, const std::string& bytecode);
+	std::filesystem::path GetBytecodeFile(const std::string& path, const u64 hash) const;
+
+	const LuaBudget& GetBudget(const std::string& path) const;
+
+	// The budget a path runs under, at an address that stays the same when budgets change
+	const LuaBudget* ResolveBudget(const std::string& path);
+	void UpdateBudgetsLimited();
+
+	// Compiled traces never run the count hook, so the jit is turned off for budgeted prototypes
+	void ApplyBudget(const std::string& path, sol::protected_function& prototype);
+
+	// Installs the count hook while budgets or stack sampling need it
+	void UpdateHook();
+	static void Hook(lua_State* L, lua_Debug* debug);
+
+	// Returns false when the callback failed, _overBudget tells whether it was stopped for its budget
+	template<typename... Args>
+	bool RunCallback(const sol::protected_function& function, const std::string& path, const LuaBudget* resolved, const u32 entity, Args&&... args)
+	{
+		_overBudget = false;
+
+		// Restored after the call, coroutines started from it belong to this script
+		const std::string* previousPath = _runningPath;
+		const LuaBudget* previousBudget = _runningBudget;
+		const u32 previousEntity = _runningEntity;
+		_runningPath = &path;
+		_runningBudget = resolved;
+		_runningEntity = entity;
+
+		const LuaBudget& budget = resolved ? *resolved : _defaultBudget;
+		if (!budget.IsLimited())
+		{
+			const bool result = Lua::Call(function, path, std::forward<Args>(args)...);
+			_runningPath = previousPath;
+			_runningBudget = previousBudget;
+			_runningEntity = previousEntity;
+
+			return result;
+		}
+
+		_running = &budget;
+		_runningInstructions = 0;
+		_runningDeadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budget.time));
+		const bool result = Lua::Call(function, path, std::forward<Args>(args)...);
+
+		_running = nullptr;
+		_runningPath = previousPath;
+		_runningBudget = previousBudget;
+		_runningEntity = previousEntity;
+
+		if (_overBudget)
+		{
+			ReportOverBudget(path, entity);
+		}
+
+		return result;
+	}
+
+	void ReportOverBudget(const std::string& path, const u32 entity);
+
+	template<typename T>
+	static void QueueEvent(std::vector<T>& events, const T& event)
+	{
+		events.push_back(event);
+	}
+
+	// Found through the registry from any state or coroutine
+	static LuaManager* GetManager(lua_State* L);
+
+	// Lua functions, the waits yield the running coroutine until the scheduler resumes it
+	static i32 StartCoroutine(lua_State* L);
+	static i32 Wait(lua_State* L);
+	static i32 WaitFrames(lua_State* L);
+	static i32 WaitEvent(lua_State* L);
+
+	// Subscribers stay until unsubscribed or until their script goes away
+	bool Subscribe(const std::string& name, const sol::protected_function& function);
+	void Unsubscribe(const std::string& name, const sol::protected_function& function);
+
+	// RegisterSystem{name = "Movement", priority = 50, interval = 0.1, queries = {"Transform"}, update = function(dt, views) ... end}
+	bool RegisterSystem(const sol::table& definition);
+
+	void RemoveSystem(const u32 id);
+
+	template<typename F>
+	void RemoveSystems(F&& remove)
+	{
+		for (u32 i = 0; i < _systems.size(); i++)
+		{
+			if (_systems[i].system && remove(_systems[i]))
+			{
+				RemoveSystem(i);
+			}
+		}
+	}
+
+	// Keys pack the coroutine's index with its generation
+	LuaCoroutine* GetRunningCoroutine(lua_State* L, u64& key);
+	void UpdateCoroutines(const float deltaT);
+	void ResumeCoroutine(const u64 key, const sol::object& payload);
+	void ReleaseCoroutine(const u32 index);
+
+	// Releases the coroutines of scripts that were removed, reloaded or destroyed
+	void SweepCoroutines();
+
+	// The script running when the function at index was handed over, and whether it is still loaded
+	LuaScriptOwner GetFunctionOwner(lua_State* L, const i32 index) const;
+	bool IsOwnerAlive(const LuaScriptOwner& owner) const;
+
+	template<typename F>
+	void StopCoroutines(F&& stop)
+	{
+		for (u32 i = 0; i < _coroutines.size(); i++)
+		{
+			if (_coroutines[i].thread && stop(_coroutines[i]))
+			{
+				ReleaseCoroutine(i);
+			}
+		}
+	}
+
+	// Returns the number of environments the script was reloaded into
+	u32 ReloadScript(const std::string& path);
+	void WatchScript(const std::string& path);
+
+	// Counts the scripts loaded from a path, its file is unwatched once the last is removed
+	void AddScriptUser(const std::string& path);
+	void RemoveScriptUser(const std::string& path);
+
+	void BindEntityCallbacks(const entt::entity entity, Component::LuaScript& script, const LuaSharedScript& shared);
+	void RebuildUpdateScripts();
+
+	u32 GetScriptGroup(const std::string& path, const LuaSharedScript& shared);
+	void UpdateScriptGroups(const float deltaT);
+
 private:
 
 	Context* _context;
 
 	std::unordered_map<std::string, LuaScript> _scripts;
+
+	// Compiled chunks, every environment loading the same path runs the same one
+	std::unordered_map<std::string, sol::protected_function> _prototypes;
+	std::unordered_map<std::string, LuaSharedScript> _sharedScripts;
+
+	// Dumped chunks by path, the dump keeps the chunk name it was compiled with so identical sources can't share one
+	std::unordered_map<std::string, LuaBytecode> _bytecode;
+	std::string _bytecodeDirectory;
+
+	LuaBudget _defaultBudget;
+	std::unordered_map<std::string, LuaBudget> _budgets;
+
+	// Every path's budget, kept in place as budgets change so scripts can hold on to them
+	std::unordered_map<std::string, LuaBudget> _resolvedBudgets;
+
+	// Whether any budget is limited, only changes with the budgets
+	bool _budgetsLimited = false;
+
+	// The budget and path of the callback currently running
+	const LuaBudget* _running = nullptr;
+	const std::string* _runningPath = nullptr;
+	const LuaBudget* _runningBudget = nullptr;
+	u32 _runningEntity = LuaProfiler::noEntity;
+	u64 _runningInstructions = 0;
+	std::chrono::steady_clock::time_point _runningDeadline;
+	bool _overBudget = false;
+
+	// Kept from before the global was removed, used to turn the compiler off per prototype
+	sol::table _jit;
+	bool _hook = false;
+
+	double _garbageTime = 0;
+	u64 _garbageCeiling = 0;
+	bool _manualGarbage = false;
+
+	// A new cycle starts once the heap doubles from what the last one left, like the automatic collector's pause
+	u64 _garbageThreshold = 0;
+	bool _garbageCycle = false;
+	LuaGarbageStats _garbageStats;
+
+	FileWatcher _watcher;
+	std::vector<std::string> _changedScripts;
+	std::unordered_map<std::string, u32> _scriptUsers;
+	bool _hotReload = false;
+
+	// Global scripts defining Update
+	std::vector<std::pair<const std::string*, LuaScript*>> _updateScripts;
+
+	std::unordered_map<std::string, LuaComponentView> _componentViews;
+
+	std::vector<LuaScriptGroup> _scriptGroups;
+	std::unordered_map<std::string, u32> _scriptGroupIndices;
+
+	// A deque so a coroutine started while another runs doesn't move it
+	std::deque<LuaCoroutine> _coroutines;
+	std::vector<u32> _freeCoroutines;
+	std::unordered_map<lua_State*, u32> _coroutineIndices;
+
+	// Milliseconds and frames, only due coroutines are visited each tick
+	TimerWheel _timeWheel;
+	TimerWheel _frameWheel;
+	double _coroutineTime = 0;
+	std::vector<u64> _dueCoroutines;
+
+	std::unordered_map<std::string, std::vector<u64>> _eventWaits;
+	std::vector<std::pair<u64, sol::object>> _eventWakes;
+	std::vector<std::pair<u64, sol::object>> _wakingCoroutines;
+
+	bool _sweepCoroutines = false;
+
+	std::unordered_map<std::string, LuaEventQueue> _eventQueues;
+
+	// A deque so a system registering another from its update keeps its own entry in place
+	std::deque<LuaScriptSystem> _systems;
+	std::vector<u32> _freeSystems;
+
+	// A system removed from inside its own update is released once the update returns
+	u32 _runningSystem = ~0u;
+	bool _removeRunningSystem = false;
+
+	std::vector<std::unique_ptr<LuaShard>> _shards;
+	std::unique_ptr<ThreadPool> _shardPool;
+	LuaSnapshot _snapshot;
 };
\ No newline at end of file
@@ -0,0 +1,320 @@
+#include "LuaProfiler.h"
+
+#include "ResourceId.h"
+
+#include "Lua/MyLua.h"
+#include "rlImGui/imgui.h"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+
+namespace
+{
+	const char* CallbackName(const LuaCallback callback)
+	{
+		switch (callback)
+		{
+			case LuaCallback::Load: return "Load";
+			case LuaCallback::Update: return "Update";
+			case LuaCallback::UpdateAll: return "UpdateAll";
+			case LuaCallback::Coroutine: return "Coroutine";
+			case LuaCallback::Event: return "Event";
+			case LuaCallback::System: return "System";
+		}
+
+		return "Unknown";
+	}
+}
+
+LuaProfiler::~LuaProfiler()
+{
+	Detach();
+}
+
+void LuaProfiler::Attach(lua_State* L)
+{
+	Detach();
+
+	_state = L;
+	_allocator = lua_getallocf(L, &_allocatorData);
+
+	lua_setallocf(L, Allocate, this);
+}
+
+void LuaProfiler::Detach()
+{
+	if (!_state)
+	{
+		return;
+	}
+
+	// Blocks allocated through the wrapper came from this allocator, the state keeps working without us
+	lua_setallocf(_state, _allocator, _allocatorData);
+
+	_state = nullptr;
+}
+
+void LuaProfiler::SetEnabled(const bool enabled)
+{
+	_enabled = enabled;
+
+	if (!enabled)
+	{
+		SetSampling(false);
+	}
+}
+
+bool LuaProfiler::IsEnabled() const
+{
+	return _enabled;
+}
+
+void LuaProfiler::SetSampling(const bool enabled, const u32 interval)
+{
+	_sampleInterval = std::max<u32>(interval, 1);
+	_sampling = enabled && _enabled;
+}
+
+bool LuaProfiler::IsSampling() const
+{
+	return _sampling;
+}
+
+void LuaProfiler::RecordFrame(const double garbageTime, const u64 heap)
+{
+	if (!_enabled)
+	{
+		return;
+	}
+
+	_garbageTimes[_frame % frameHistory] = garbageTime * 1000.0;
+	_heapSizes[_frame % frameHistory] = heap / (1024.0 * 1024.0);
+	_frame++;
+}
+
+void LuaProfiler::Record(const std::string& path, const u32 entity, const LuaCallback callback, const double time, const u64 bytes)
+{
+	const Key key{ResourceId::Hash(path), entity, callback};
+
+	auto it = _indices.find(key);
+	if (it == _indices.end())
+	{
+		LuaProfileSample& sample = _samples.emplace_back();
+		sample.name = entity == noEntity ? path : path + " [" + std::to_string(entity) + "]";
+		sample.callback = callback;
+
+		it = _indices.emplace(key, _samples.size() - 1).first;
+	}
+
+	LuaProfileSample& sample = _samples[it->second];
+	sample.calls++;
+	sample.bytes += bytes;
+	sample.time += time;
+	sample.maxTime = std::max(sample.maxTime, time);
+}
+
+void LuaProfiler::Reset()
+{
+	_indices.clear();
+	_samples.clear();
+	_stacks.clear();
+}
+
+u64 LuaProfiler::GetAllocatedBytes() const
+{
+	return _allocated;
+}
+
+const std::vector<LuaProfileSample>& LuaProfiler::GetSamples() const
+{
+	return _samples;
+}
+
+bool LuaProfiler::Export(const char* path) const
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		LogColor(LOG_YELLOW, "Failed to export lua profile to ", path);
+
+		return false;
+	}
+
+	file << "script,callback,calls,total_ms,average_us,max_us,bytes\n";
+	for (const LuaProfileSample& sample : _samples)
+	{
+		file << '"' << sample.name << "\"," << CallbackName(sample.callback) << ',' << sample.calls << ','
+			<< sample.time * 1000.0 << ',' << sample.time / std::max<u64>(sample.calls, 1) * 1000000.0 << ','
+			<< sample.maxTime * 1000000.0 << ',' << sample.bytes << '\n';
+	}
+
+	if (!_stacks.empty())
+	{
+		std::ofstream stacks(std::string(path) + ".folded");
+		for (const auto& [stack, count] : _stacks)
+		{
+			stacks << stack << ' ' << count << '\n';
+		}
+	}
+
+	return true;
+}
+
+void LuaProfiler::DrawPanel()
+{
+	if (!ImGui::Begin("Lua Profiler"))
+	{
+		ImGui::End();
+
+		return;
+	}
+
+	bool enabled = _enabled;
+	if (ImGui::Checkbox("Enabled", &enabled))
+	{
+		SetEnabled(enabled);
+	}
+
+	ImGui::SameLine();
+
+	bool sampling = _sampling;
+	if (ImGui::Checkbox("Sample stacks", &sampling))
+	{
+		SetSampling(sampling, _sampleInterval);
+	}
+
+	ImGui::SameLine();
+
+	if (ImGui::Button("Reset"))
+	{
+		Reset();
+	}
+
+	ImGui::SameLine();
+
+	if (ImGui::Button("Export"))
+	{
+		Export("lua_profile.csv");
+	}
+
+	ImGui::Text("Allocated %.2f MB, %zu stacks sampled", _allocated / (1024.0 * 1024.0), _stacks.size());
+
+	if (_frame)
+	{
+		const u32 last = (_frame - 1) % frameHistory;
+		const u32 offset = _frame % frameHistory;
+
+		ImGui::Text("GC %.3f ms, heap %.2f MB", _garbageTimes[last], _heapSizes[last]);
+		ImGui::PlotLines("GC ms", _garbageTimes.data(), frameHistory, offset, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+		ImGui::PlotLines("Heap MB", _heapSizes.data(), frameHistory, offset, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+	}
+
+	const ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+	if (ImGui::BeginTable("Scripts", 7, flags))
+	{
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Script");
+		ImGui::TableSetupColumn("Callback");
+		ImGui::TableSetupColumn("Calls");
+		ImGui::TableSetupColumn("Total ms");
+		ImGui::TableSetupColumn("Average us");
+		ImGui::TableSetupColumn("Max us");
+		ImGui::TableSetupColumn("Bytes");
+		ImGui::TableHeadersRow();
+
+		// Most expensive first
+		std::vector<u32> order(_samples.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [this](const u32 a, const u32 b) {
+			return _samples[a].time > _samples[b].time;
+		});
+
+		ImGuiListClipper clipper;
+		clipper.Begin(order.size());
+		while (clipper.Step())
+		{
+			for (i32 row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+			{
+				const LuaProfileSample& sample = _samples[order[row]];
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(sample.name.c_str());
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(CallbackName(sample.callback));
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", static_cast<unsigned long long>(sample.calls));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", sample.time * 1000.0);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", sample.time / std::max<u64>(sample.calls, 1) * 1000000.0);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", sample.maxTime * 1000000.0);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", static_cast<unsigned long long>(sample.bytes));
+			}
+		}
+
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+}
+
+void* LuaProfiler::Allocate(void* user, void* pointer, size_t oldSize, size_t newSize)
+{
+	LuaProfiler* profiler = static_cast<LuaProfiler*>(user);
+
+	if (newSize > oldSize)
+	{
+		profiler->_allocated += newSize - oldSize;
+	}
+
+	return profiler->_allocator(profiler->_allocatorData, pointer, oldSize, newSize);
+}
+
+void LuaProfiler::Sample(lua_State* L, const u32 instructions)
+{
+	_sampleCounter += instructions;
+	if (!_sampling || _sampleCounter < _sampleInterval)
+	{
+		return;
+	}
+
+	_sampleCounter = 0;
+
+	lua_Debug frame;
+
+	i32 depth = 0;
+	while (lua_getstack(L, depth, &frame))
+	{
+		depth++;
+	}
+
+	std::string stack;
+	for (i32 level = depth - 1; level >= 0; level--)
+	{
+		if (!lua_getstack(L, level, &frame) || !lua_getinfo(L, "Sn", &frame))
+		{
+			continue;
+		}
+
+		if (!stack.empty())
+		{
+			stack += ';';
+		}
+
+		stack += frame.short_src;
+		stack += ':';
+		stack += std::to_string(frame.linedefined);
+
+		if (frame.name)
+		{
+			stack += ' ';
+			stack += frame.name;
+		}
+	}
+
+	_stacks[stack]++;
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "Types.h"
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct lua_State;
+
+enum class LuaCallback : u8
+{
+	Load,
+	Update,
+	UpdateAll,
+	Coroutine,
+	Event,
+	System,
+};
+
+struct LuaProfileSample
+{
+	std::string name;
+	LuaCallback callback = LuaCallback::Update;
+
+	u64 calls = 0;
+	u64 bytes = 0;
+
+	double time = 0;
+	double maxTime = 0;
+};
+
+// Records wall time, calls and allocated bytes per script callback, global scripts have no entity
+class LuaProfiler
+{
+public:
+
+	static constexpr u32 noEntity = ~0u;
+
+	~LuaProfiler();
+
+	// Wraps the state's allocator so bytes can be attributed to the running callback
+	void Attach(lua_State* L);
+	void Detach();
+
+	void SetEnabled(const bool enabled);
+	bool IsEnabled() const;
+
+	// Collects lua stacks about every interval instructions, compiled traces don't run hooks so only interpreted code is seen
+	void SetSampling(const bool enabled, const u32 interval = 1000);
+	bool IsSampling() const;
+
+	// Called from the owner's count hook with the instructions run since the last call
+	void Sample(lua_State* L, const u32 instructions);
+
+	// Collector time and heap size of one frame, kept for the last frames to plot
+	void RecordFrame(const double garbageTime, const u64 heap);
+
+	void Record(const std::string& path, const u32 entity, const LuaCallback callback, const double time, const u64 bytes);
+	void Reset();
+
+	u64 GetAllocatedBytes() const;
+	const std::vector<LuaProfileSample>& GetSamples() const;
+
+	// Csv with one line per callback, the sampled stacks are written next to it in folded format
+	bool Export(const char* path) const;
+
+	void DrawPanel();
+
+private:
+
+	struct Key
+	{
+		u64 path;
+		u32 entity;
+		LuaCallback callback;
+
+		bool operator==(const Key& other) const = default;
+	};
+
+	struct KeyHasher
+	{
+		size_t operator()(const Key& key) const
+		{
+			return key.path ^ (u64(key.entity) << 8) ^ u64(key.callback);
+		}
+	};
+
+	static void* Allocate(void* user, void* pointer, size_t oldSize, size_t newSize);
+
+private:
+
+	lua_State* _state = nullptr;
+
+	// The allocator the state had before Attach
+	using Allocator = void* (*)(void* user, void* pointer, size_t oldSize, size_t newSize);
+	Allocator _allocator = nullptr;
+	void* _allocatorData = nullptr;
+
+	u64 _allocated = 0;
+
+	std::unordered_map<Key, u32, KeyHasher> _indices;
+	std::vector<LuaProfileSample> _samples;
+
+	static constexpr u32 frameHistory = 240;
+
+	std::vector<float> _garbageTimes = std::vector<float>(frameHistory);
+	std::vector<float> _heapSizes = std::vector<float>(frameHistory);
+	u32 _frame = 0;
+
+	// Folded stacks, outermost frame first
+	std::unordered_map<std::string, u64> _stacks;
+	u32 _sampleInterval = 1000;
+	u32 _sampleCounter = 0;
+
+	bool _enabled = false;
+	bool _sampling = false;
+};
+
+// Times one callback when the profiler is enabled, does nothing otherwise
+class LuaProfileScope
+{
+public:
+
+	LuaProfileScope(LuaProfiler& profiler, const std::string& path, const u32 entity, const LuaCallback callback) :
+		_profiler(profiler.IsEnabled() ? &profiler : nullptr),
+		_path(path),
+		_entity(entity),
+		_callback(callback)
+	{
+		if (_profiler)
+		{
+			_bytes = _profiler->GetAllocatedBytes();
+			_start = std::chrono::steady_clock::now();
+		}
+	}
+
+	~LuaProfileScope()
+	{
+		if (_profiler)
+		{
+			const std::chrono::duration<double> time = std::chrono::steady_clock::now() - _start;
+			_profiler->Record(_path, _entity, _callback, time.count(), _profiler->GetAllocatedBytes() - _bytes);
+		}
+	}
+
+	LuaProfileScope(const LuaProfileScope&) = delete;
+	LuaProfileScope& operator=(const LuaProfileScope&) = delete;
+
+private:
+
+	LuaProfiler* _profiler;
+	const std::string& _path;
+	u32 _entity;
+	LuaCallback _callback;
+
+	u64 _bytes = 0;
+	std::chrono::steady_clock::time_point _start;
+};
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "LuaShard.h"
+
+#include "LuaManager.h"
+
+#include "entt/entt.h"
+
+#include <chrono>
+
+const Component::Transform* LuaSnapshot::GetTransform(const entt::entity entity) const
+{
+	const u32 index = entt::to_entity(entity);
+	if (index >= indices.size() || !indices[index])
+	{
+		return nullptr;
+	}
+
+	// A recycled id with another version isn't the same entity
+	const u32 position = indices[index] - 1;
+
+	return entities[position] == entity ? &transforms[position] : nullptr;
+}
+
+LuaShard::LuaShard() :
+	lua(sol::default_at_panic, LuaAllocator::Allocate, &allocator)
+{
+	lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::string);
+
+	// Turns the compiler on like in the main state, without the global
+	lua_State* L = lua.lua_state();
+	lua_pushcfunction(L, luaopen_jit);
+	lua_call(L, 0, 0);
+	lua["jit"] = sol::lua_nil;
+
+	RegisterEngineAPIs();
+}
+
+bool LuaShard::Load(const entt::entity entity, const std::string& path, const std::string_view code)
+{
+	Remove(entity);
+
+	Script& script = _scripts.emplace_back();
+	script.entity = entity;
+	script.path = path;
+
+	if (!Run(script, code))
+	{
+		_scripts.pop_back();
+
+		return false;
+	}
+
+	_indices.emplace(entt::to_integral(entity), _scripts.size() - 1);
+
+	return true;
+}
+
+void LuaShard::Remove(const entt::entity entity)
+{
+	auto it = _indices.find(entt::to_integral(entity));
+	if (it == _indices.end())
+	{
+		return;
+	}
+
+	// Swap with the last so the array stays dense
+	const u32 index = it->second;
+	_indices.erase(it);
+
+	if (index != _scripts.size() - 1)
+	{
+		_scripts[index] = std::move(_scripts.back());
+		_indices[entt::to_integral(_scripts[index].entity)] = index;
+	}
+
+	_scripts.pop_back();
+}
+
+u32 LuaShard::Reload(const std::string& path, const std::string_view code)
+{
+	_sharedScripts.erase(path);
+
+	u32 count = 0;
+	for (Script& script : _scripts)
+	{
+		if (script.path == path)
+		{
+			Run(script, code);
+			count++;
+		}
+	}
+
+	return count;
+}
+
+void LuaShard::Update(const float deltaT, const LuaSnapshot& snapshot)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	_snapshot = &snapshot;
+	_commands.Clear();
+
+	for (const Script& script : _scripts)
+	{
+		if (script.update.valid())
+		{
+			Lua::Call(script.update, script.path, script.environment, deltaT);
+		}
+	}
+
+	_snapshot = nullptr;
+
+	const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+	_updateTime = time.count();
+}
+
+LuaCommandBuffer& LuaShard::GetCommands()
+{
+	return _commands;
+}
+
+u32 LuaShard::GetScriptCount() const
+{
+	return _scripts.size();
+}
+
+double LuaShard::GetUpdateTime() const
+{
+	return _updateTime;
+}
+
+void LuaShard::RegisterEngineAPIs()
+{
+	LuaManager::RegisterEngineTypes(lua);
+
+	// Copies from the snapshot, changes only land through SetTransform
+	Lua::RegisterFunction(lua, "GetTransform", [this](entt::entity entity) -> sol::object {
+		const Component::Transform* transform = _snapshot ? _snapshot->GetTransform(entity) : nullptr;
+		if (!transform)
+		{
+			return sol::lua_nil;
+		}
+
+		return sol::make_object(lua, *transform);
+	});
+
+	Lua::RegisterFunction(lua, "HasTransform", [this](entt::entity entity) -> bool {
+		return _snapshot && _snapshot->GetTransform(entity);
+	});
+
+	Lua::RegisterFunction(lua, "SetTransform", [this](entt::entity entity, const Component::Transform& transform) {
+		_commands.transforms.emplace_back(entity, transform);
+	});
+}
+
+LuaShard::SharedScript* LuaShard::GetSharedScript(const std::string& path, const std::string_view code)
+{
+	auto it = _sharedScripts.find(path);
+	if (it != _sharedScripts.end())
+	{
+		return &it->second;
+	}
+
+	sol::load_result result = lua.load(code, "@" + path, sol::load_mode::text);
+	if (!result.valid())
+	{
+		sol::error e = result;
+		LogColor(LOG_YELLOW, "Failed to load lua file ", path, " with error: ", e.what());
+
+		return nullptr;
+	}
+
+	sol::protected_function chunk = result.get<sol::protected_function>();
+
+	SharedScript shared;
+	shared.functions = Lua::CreateEnvironment(lua, true);
+	sol::set_environment(shared.functions, chunk);
+
+	if (!Lua::Call(chunk, path))
+	{
+		return nullptr;
+	}
+
+	LuaCallbacks callbacks;
+	callbacks.Bind(shared.functions);
+	shared.update = callbacks.update;
+	shared.start = callbacks.start;
+	shared.metatable = lua.create_table_with("__index", shared.functions);
+
+	return &_sharedScripts.emplace(path, std::move(shared)).first->second;
+}
+
+bool LuaShard::Run(Script& script, const std::string_view code)
+{
+	SharedScript* shared = GetSharedScript(script.path, code);
+	if (!shared)
+	{
+		return false;
+	}
+
+	script.environment = sol::environment(lua, sol::create);
+	script.environment[sol::metatable_key] = shared->metatable;
+	Lua::BindObject(script.environment, "Entity", script.entity);
+
+	script.update = shared->update;
+
+	return !shared->start.valid() || Lua::Call(shared->start, script.path, script.environment);
+}
\ No newline at end of file
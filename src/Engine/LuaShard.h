@@ -0,0 +1,110 @@
+#pragma once
+
+// Forward
+#include <cstdint>
+namespace entt
+{
+    enum class entity : uint32_t;
+}
+
+#include "Lua/MyLua.h"
+#include "Components.h"
+#include "LuaAllocator.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Component data as it was when the shards started, they read from here while the main state keeps writing the registry
+struct LuaSnapshot
+{
+	std::vector<entt::entity> entities;
+	std::vector<Component::Transform> transforms;
+
+	// Entity index to position in the arrays plus one, zero when it had no transform
+	std::vector<u32> indices;
+
+	const Component::Transform* GetTransform(const entt::entity entity) const;
+};
+
+// Writes from a shard, applied on the main thread in shard order once every shard finished
+struct LuaCommandBuffer
+{
+	std::vector<std::pair<entt::entity, Component::Transform>> transforms;
+
+	void Clear()
+	{
+		transforms.clear();
+	}
+};
+
+// An independent lua state running entity scripts on a worker thread, nothing in it is reachable from another state
+class LuaShard
+{
+public:
+
+	LuaShard();
+
+	LuaShard(const LuaShard&) = delete;
+	LuaShard& operator=(const LuaShard&) = delete;
+
+	// Code is the script's source, compiled once per path in this state
+	bool Load(const entt::entity entity, const std::string& path, const std::string_view code);
+	void Remove(const entt::entity entity);
+
+	// Returns the number of entities the script was reloaded for
+	u32 Reload(const std::string& path, const std::string_view code);
+
+	// Runs on a worker, reads only the snapshot and writes only the command buffer
+	void Update(const float deltaT, const LuaSnapshot& snapshot);
+
+	LuaCommandBuffer& GetCommands();
+	u32 GetScriptCount() const;
+	double GetUpdateTime() const;
+
+public:
+
+	// Declared before the state, which allocates through it until closed
+	LuaAllocator allocator;
+
+	sol::state lua;
+
+private:
+
+	// The chunk run once per path, like the main state's entity scripts
+	struct SharedScript
+	{
+		sol::environment functions;
+		sol::table metatable;
+		sol::protected_function update;
+		sol::protected_function start;
+	};
+
+	// The environment is the entity's instance, handed to Update as self
+	struct Script
+	{
+		entt::entity entity;
+		std::string path;
+		sol::environment environment;
+		sol::protected_function update;
+	};
+
+	void RegisterEngineAPIs();
+
+	SharedScript* GetSharedScript(const std::string& path, const std::string_view code);
+	bool Run(Script& script, const std::string_view code);
+
+private:
+
+	std::vector<Script> _scripts;
+	std::unordered_map<u32, u32> _indices;
+
+	std::unordered_map<std::string, SharedScript> _sharedScripts;
+
+	// Only set while Update runs
+	const LuaSnapshot* _snapshot = nullptr;
+	LuaCommandBuffer _commands;
+
+	double _updateTime = 0;
+};
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include "LuaSystem.h"
+
+#include "Context.h"
+
+namespace
+{
+	// Ticks rarely add up to the interval exactly
+	constexpr float intervalTolerance = 0.0001f;
+}
+
+LuaSystem::LuaSystem(const Context& context, const u32 id, const float interval) :
+System(context),
+_id(id),
+_interval(interval)
+{
+
+}
+
+void LuaSystem::Update(const float deltaT)
+{
+	_accumulator += deltaT;
+	if (_accumulator + intervalTolerance < _interval)
+	{
+		return;
+	}
+
+	// The script gets all the time since its last run
+	const float elapsed = _accumulator;
+	_accumulator = 0;
+
+	_context.luaManager.UpdateSystem(_id, elapsed);
+}
+
+void LuaSystem::Draw()
+{
+
+}
\ No newline at end of file
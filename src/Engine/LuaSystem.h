@@ -0,0 +1,21 @@
+#pragma once
+
+#include "SystemManager.h"
+
+// A system a script registered, runs in its place among the c++ systems at its own rate
+class LuaSystem : public System
+{
+public:
+
+	// Interval in seconds between runs, zero runs every tick
+	LuaSystem(const Context& context, const u32 id, const float interval);
+
+	void Update(const float deltaT) override;
+	void Draw() override;
+
+private:
+
+	u32 _id;
+	float _interval;
+	float _accumulator = 0;
+};
\ No newline at end of file
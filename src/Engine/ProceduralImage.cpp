@@ -0,0 +1,105 @@
+#include "ProceduralImage.h"
+
+#include "ResourceManager.h"
+
+#include <cstdio>
+#include <filesystem>
+
+std::string ProceduralImageDesc::GetName() const
+{
+	static const char* shapeNames[] = {"rounded_rectangle", "circle"};
+
+	char buffer[128];
+	std::snprintf(buffer, sizeof(buffer), "procedural/%s_%u_%02x%02x%02x%02x_%.3f_%.3f", shapeNames[static_cast<u8>(shape)], size,
+		color.r, color.g, color.b, color.a, roundness, margin);
+
+	return buffer;
+}
+
+namespace Procedural
+{
+	ResourceId GetImage(ResourceManager& resourceManager, const ProceduralImageDesc& desc, const char* cacheDirectory)
+	{
+		const std::string name = desc.GetName();
+		const ResourceId id(name);
+
+		ResourceCache<Image>& images = resourceManager.GetCache<Image>();
+		if (images.Contains(id))
+		{
+			return id;
+		}
+
+		ResourceId::Intern(name);
+
+		if (!cacheDirectory)
+		{
+			images.Insert(id, GenerateImage(desc));
+
+			return id;
+		}
+
+		const std::filesystem::path path = std::filesystem::path(cacheDirectory) / (name + ".png");
+		const std::string pathString = path.string();
+
+		if (FileExists(pathString.c_str()))
+		{
+			Image image = LoadImage(pathString.c_str());
+			if (image.data && (u32)image.width == desc.size && (u32)image.height == desc.size)
+			{
+				images.Insert(id, image);
+
+				return id;
+			}
+
+			UnloadImage(image);
+		}
+
+		Image image = GenerateImage(desc);
+
+		std::error_code error;
+		std::filesystem::create_directories(path.parent_path(), error);
+		ExportImage(image, pathString.c_str());
+
+		images.Insert(id, image);
+
+		return id;
+	}
+
+	Image GenerateImage(const ProceduralImageDesc& desc)
+	{
+		const float size = desc.size;
+
+		Image image = GenImageColor(desc.size, desc.size, BLANK);
+
+		switch (desc.shape)
+		{
+			case ProceduralShape::RoundedRectangle:
+				ImageDrawRectangleRounded(&image, {desc.margin, desc.margin, size - desc.margin, size - desc.margin}, desc.roundness, desc.color);
+				break;
+
+			case ProceduralShape::Circle:
+				ImageDrawCircleV(&image, {size / 2, size / 2}, size / 2 - desc.margin, desc.color);
+				break;
+		}
+
+		return image;
+	}
+
+	void ImageDrawRectangleRounded(Image* image, const Rectangle rectangle, const float roundness, const Color color)
+	{
+	    float r = roundness * (rectangle.width < rectangle.height ? rectangle.width : rectangle.height);
+
+	    ImageDrawRectangleRec(image, {rectangle.x + r, rectangle.y, rectangle.width - 2*r, rectangle.height}, color);
+	    ImageDrawRectangleRec(image, {rectangle.x, rectangle.y + r, rectangle.width, rectangle.height - 2*r}, color);
+
+	    Vector2 tl = { rectangle.x + r, rectangle.y + r };
+	    Vector2 tr = { rectangle.x + rectangle.width - r, rectangle.y + r };
+	    Vector2 bl = { rectangle.x + r, rectangle.y + rectangle.height - r };
+	    Vector2 br = { rectangle.x + rectangle.width - r, rectangle.y + rectangle.height - r };
+
+	    ImageDrawCircleV(image, tl, r, color);
+	    ImageDrawCircleV(image, tr, r, color);
+	    ImageDrawCircleV(image, bl, r, color);
+	    ImageDrawCircleV(image, br, r, color);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Types.h"
+
+#include "ResourceId.h"
+
+#include "Raylib/raylib.h"
+
+#include <string>
+
+class ResourceManager;
+
+enum class ProceduralShape : u8
+{
+	RoundedRectangle,
+	Circle,
+};
+
+// Everything a generated image depends on, equal descriptions always produce the same image
+struct ProceduralImageDesc
+{
+	ProceduralShape shape = ProceduralShape::RoundedRectangle;
+	u32 size = 0;
+	Color color = WHITE;
+
+	// Fraction of the smaller side used as corner radius
+	float roundness = 0;
+	float margin = 0;
+
+	// Unique name built from the parameters, used as the image path and disk cache file name
+	std::string GetName() const;
+};
+
+namespace Procedural
+{
+	// Returns the id of the image in the image cache, generating it only the first time
+	// With a cache directory generated images are also saved as png and loaded back on later runs
+	ResourceId GetImage(ResourceManager& resourceManager, const ProceduralImageDesc& desc, const char* cacheDirectory = nullptr);
+
+	Image GenerateImage(const ProceduralImageDesc& desc);
+
+	void ImageDrawRectangleRounded(Image* image, const Rectangle rectangle, const float roundness, const Color color);
+}
\ No newline at end of file
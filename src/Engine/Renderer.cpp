@@ -15,6 +15,8 @@ Renderer::Renderer()
 
 void Renderer::Draw(entt::registry& registry)
 {
+	atlas.ReleaseRetiredPages();
+
 	SortSprites(registry);
 
 	BeginMode2D(camera);
@@ -23,9 +25,15 @@ void Renderer::Draw(entt::registry& registry)
 
 	for (auto [entity, transform, sprite] : view.each())
 	{
+		// Resources removed while sprites still use them are skipped
+		if (!sprite.texture.IsReady())
+		{
+			continue;
+		}
+
 		if (IsRectangleVisible(sprite.rectangle, sprite.scale, transform.position.vec2(), camera))
 		{
-			DrawTextureRotScaleSelect(sprite.texture, sprite.rectangle, transform.position.vec2(), transform.rotation, sprite.scale, sprite.color);
+			DrawTextureRotScaleSelect(sprite.texture.Get(), sprite.rectangle, transform.position.vec2(), transform.rotation, sprite.scale, sprite.color);
 		}
 	}
 
@@ -34,8 +42,14 @@ void Renderer::Draw(entt::registry& registry)
 
 void Renderer::SortSprites(entt::registry& registry)
 {
+	// Within a layer sprites sharing a texture are kept together so they draw in one batch
 	registry.sort<Component::Sprite>([](const Component::Sprite& a, const Component::Sprite& b)
 	{
-        return a.layer < b.layer;
+        if (a.layer != b.layer)
+        {
+            return a.layer < b.layer;
+        }
+
+        return a.texture < b.texture;
     });
 }
\ No newline at end of file
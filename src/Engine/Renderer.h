@@ -3,6 +3,8 @@
 #include "entt/entt.h"
 #include "Raylib/raylib.h"
 
+#include "TextureAtlas.h"
+
 class Renderer
 {
 public:
@@ -18,4 +20,7 @@ private:
 public:
 
 	Camera2D camera;
+
+	// Shared by every sprite so a scene draws in as few batches as possible
+	TextureAtlas atlas;
 };
\ No newline at end of file
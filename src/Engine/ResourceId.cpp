@@ -0,0 +1,53 @@
+#include "ResourceId.h"
+
+#include "Assert.h"
+
+namespace
+{
+	std::mutex internMutex;
+
+	// Nodes are never removed so returned references stay valid
+	std::unordered_map<u64, std::string>& InternTable()
+	{
+		static std::unordered_map<u64, std::string> table;
+
+		return table;
+	}
+}
+
+ResourceId ResourceId::Intern(const std::string_view path)
+{
+	const ResourceId id(path);
+
+	std::lock_guard<std::mutex> lock(internMutex);
+
+	auto& table = InternTable();
+	auto it = table.find(id.hash);
+	if (it == table.end())
+	{
+		table.emplace(id.hash, std::string(path));
+	}
+
+	else
+	{
+		Assert(it->second == path, "Resource id collision between ", it->second.c_str(), " and ", std::string(path).c_str());
+	}
+
+	return id;
+}
+
+const std::string& ResourceId::GetPath(const ResourceId id)
+{
+	static const std::string empty;
+
+	std::lock_guard<std::mutex> lock(internMutex);
+
+	auto& table = InternTable();
+	auto it = table.find(id.hash);
+	if (it == table.end())
+	{
+		return empty;
+	}
+
+	return it->second;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Types.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <mutex>
+
+// 64 bit FNV-1a hash of a resource path, usable at compile time
+struct ResourceId
+{
+	u64 hash = 0;
+
+	constexpr ResourceId() = default;
+
+	constexpr explicit ResourceId(const std::string_view path) :
+	hash(Hash(path))
+	{
+
+	}
+
+	constexpr bool operator==(const ResourceId& other) const = default;
+
+	constexpr explicit operator bool() const
+	{
+		return hash != 0;
+	}
+
+	static constexpr u64 Hash(const std::string_view path)
+	{
+		u64 result = 14695981039346656037ull;
+
+		for (const char c : path)
+		{
+			result ^= static_cast<u8>(c);
+			result *= 1099511628211ull;
+		}
+
+		return result;
+	}
+
+	// Stores the path so it can be recovered from the id, returns the existing entry if already interned
+	static ResourceId Intern(const std::string_view path);
+
+	// Empty if the id was never interned
+	static const std::string& GetPath(const ResourceId id);
+
+	// Already a hash so no need to hash again
+	struct Hasher
+	{
+		std::size_t operator()(const ResourceId id) const
+		{
+			return id.hash;
+		}
+	};
+};
+
+consteval ResourceId operator""_id(const char* path, std::size_t size)
+{
+	return ResourceId(std::string_view(path, size));
+}
\ No newline at end of file
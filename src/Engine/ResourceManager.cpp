@@ -1,6 +1,177 @@
 #include "ResourceManager.h"
 
+void AsyncLoader::PushLoad(std::function<void ()> task)
+{
+	_pool.Push(std::move(task));
+}
+
+void AsyncLoader::PushUpload(std::function<void ()> upload)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_uploads.push_back(std::move(upload));
+}
+
+u32 AsyncLoader::ProcessUploads(const u32 maxUploads)
+{
+	u32 count = 0;
+
+	while (count < maxUploads)
+	{
+		std::function<void ()> upload;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_uploads.empty())
+			{
+				break;
+			}
+
+			upload = std::move(_uploads.front());
+			_uploads.pop_front();
+		}
+
+		upload();
+		count++;
+	}
+
+	return count;
+}
+
+void AsyncLoader::Wait()
+{
+	_pool.Wait();
+
+	while (ProcessUploads(max_u32));
+}
+
+void ResourceManager::Update()
+{
+	resourceFrame.fetch_add(1, std::memory_order_relaxed);
+
+	_loader.ProcessUploads(_uploadsPerFrame);
+
+	if (_hotReload && std::chrono::steady_clock::now() - _lastReloadCheck >= _hotReloadInterval)
+	{
+		_lastReloadCheck = std::chrono::steady_clock::now();
+
+		for (const auto& cache : _caches)
+		{
+			if (cache)
+			{
+				cache->ReloadChanged();
+			}
+		}
+	}
+
+	Trim();
+}
+
+void ResourceManager::WaitForLoads()
+{
+	_loader.Wait();
+}
+
+void ResourceManager::SetUploadsPerFrame(const u32 count)
+{
+	Assert(count, "At least one upload per frame is needed");
+
+	_uploadsPerFrame = count;
+}
+
+void ResourceManager::SetBudget(const u64 bytes)
+{
+	_budget = bytes;
+}
+
+u64 ResourceManager::GetMemoryUsage() const
+{
+	u64 memory = 0;
+	for (const auto& cache : _caches)
+	{
+		if (cache)
+		{
+			memory += cache->GetMemoryUsage();
+		}
+	}
+
+	return memory;
+}
+
+void ResourceManager::SetHotReload(const bool enabled, const float interval)
+{
+	_hotReload = enabled;
+	_hotReloadInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(interval));
+
+	_pack.SetLooseFileOverride(enabled);
+
+	for (const auto& cache : _caches)
+	{
+		if (cache)
+		{
+			cache->_watchFiles = enabled;
+		}
+	}
+}
+
+bool ResourceManager::MountPack(const char* path)
+{
+	return _pack.Open(path);
+}
+
+AssetPack& ResourceManager::GetPack()
+{
+	return _pack;
+}
+
 void ResourceManager::ClearCaches()
 {
+	_loader.Wait();
+
 	_caches.clear();
+}
+
+void ResourceManager::Trim()
+{
+	for (const auto& cache : _caches)
+	{
+		if (cache)
+		{
+			cache->Trim();
+		}
+	}
+
+	if (!_budget)
+	{
+		return;
+	}
+
+	u64 memory = GetMemoryUsage();
+	while (memory > _budget)
+	{
+		Cache* oldest = nullptr;
+		u64 oldestUse = max_u64;
+
+		for (const auto& cache : _caches)
+		{
+			if (!cache)
+			{
+				continue;
+			}
+
+			const u64 use = cache->GetOldestUse();
+			if (use < oldestUse)
+			{
+				oldest = cache.get();
+				oldestUse = use;
+			}
+		}
+
+		// Everything left is referenced or pinned
+		if (!oldest || !oldest->EvictOldest())
+		{
+			break;
+		}
+
+		memory = GetMemoryUsage();
+	}
 }
\ No newline at end of file
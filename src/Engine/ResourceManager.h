@@ -1,19 +1,331 @@
 #pragma once
 
 #include "Assert.h"
+#include "Types.h"
 
+#include "AssetPack.h"
+#include "ResourceId.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <type_traits>
-#include <typeindex>
+#include <typeinfo>
 #include <unordered_map>
+#include <vector>
 #include <memory>
 #include <functional>
+#include <optional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+
+enum class ResourceState : u8
+{
+	Loading, // Being read and decoded on a loader thread
+	Decoded, // Waiting for its main thread upload
+	Ready,
+};
+
+// Frame counter advanced by ResourceManager::Update, used to order evictions
+inline std::atomic<u64> resourceFrame = 0;
+
+// Functions and memory accounting shared by a cache and its entries, entries can outlive the cache
+template<class T>
+struct ResourceShared
+{
+	std::function<void (T)> unload;
+	std::function<u64 (const T&)> size;
+
+	// Bytes held by ready entries, main thread only
+	u64 memory = 0;
+};
+
+// Shared by the cache, handles and in flight loads so a load can finish after the cache dropped it
+template<class T>
+struct ResourceEntry
+{
+	std::atomic<ResourceState> state = ResourceState::Loading;
+	std::optional<T> object;
+
+	std::function<T ()> upload;
+	std::shared_ptr<ResourceShared<T>> shared;
+
+	u64 size = 0;
+	std::atomic<u64> lastUsed = 0;
+
+	// Bumped every time the object is swapped for a reloaded one
+	u32 generation = 0;
+
+	// Last write time of the source file, empty for resources not loaded from a file
+	std::optional<std::filesystem::file_time_type> writeTime;
+
+	// Objects handed out as raw references can't be tracked so are never evicted
+	bool pinned = false;
+
+	// Set when removed before becoming ready, the upload is then unloaded right away
+	bool discarded = false;
+
+	std::mutex mutex;
+	std::condition_variable decoded;
+
+	// Main thread only
+	void SetObject(T result)
+	{
+		if (discarded)
+		{
+			shared->unload(result);
+		}
+
+		else
+		{
+			object.emplace(result);
+
+			size = shared->size ? shared->size(*object) : 0;
+			shared->memory += size;
+		}
+
+		state = ResourceState::Ready;
+	}
+
+	// Main thread only, swaps the object so every handle sees the new one from the next access
+	void Replace(T result)
+	{
+		if (object)
+		{
+			shared->unload(*object);
+			shared->memory -= size;
+		}
+
+		object.emplace(result);
+
+		size = shared->size ? shared->size(*object) : 0;
+		shared->memory += size;
+
+		generation++;
+	}
+
+	// Main thread only
+	void Release()
+	{
+		if (state != ResourceState::Ready)
+		{
+			discarded = true;
+
+			return;
+		}
+
+		if (object)
+		{
+			shared->unload(*object);
+			object.reset();
+
+			shared->memory -= size;
+			size = 0;
+		}
+	}
+
+	// Main thread only
+	void Finish()
+	{
+		std::function<T ()> function;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (state != ResourceState::Decoded)
+			{
+				return;
+			}
+
+			function = std::move(upload);
+			upload = nullptr;
+		}
+
+		SetObject(function());
+	}
+
+	// Main thread only, blocks until decoded then uploads in place
+	void Wait()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			decoded.wait(lock, [this]()
+			{
+				return state != ResourceState::Loading;
+			});
+		}
+
+		Finish();
+	}
+
+	void Touch()
+	{
+		lastUsed.store(resourceFrame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+};
+
+// Keeps its resource from being evicted for as long as a copy of it exists
+// Components store handles instead of the resource itself so reloads are picked up
+template<class T>
+class ResourceHandle
+{
+public:
+
+	ResourceHandle() = default;
+
+	bool operator==(const ResourceHandle& other) const = default;
+
+	// Orders by resource so equal resources sort together
+	bool operator<(const ResourceHandle& other) const
+	{
+		return _entry < other._entry;
+	}
+
+	bool IsValid() const
+	{
+		return _entry != nullptr;
+	}
+
+	bool IsReady() const
+	{
+		return _entry && _entry->state == ResourceState::Ready && _entry->object;
+	}
+
+	T& Get() const
+	{
+		Assert(IsReady(), "Resource is not loaded yet");
+
+		_entry->Touch();
+
+		return *_entry->object;
+	}
+
+	// Blocks until the resource is usable
+	T& Wait() const
+	{
+		Assert(IsValid(), "Invalid resource handle");
+
+		_entry->Wait();
+		Assert(_entry->object, "Resource was removed before it finished loading");
+
+		_entry->Touch();
+
+		return *_entry->object;
+	}
+
+	// A stale handle outlived its resource being removed or evicted
+	bool IsStale() const
+	{
+		return _entry && _entry->state == ResourceState::Ready && !_entry->object;
+	}
+
+	// Changes each time the resource is reloaded, for anything derived from it that needs rebuilding
+	u32 GetGeneration() const
+	{
+		return _entry ? _entry->generation : 0;
+	}
+
+	// Handles referencing the same resource, including this one
+	u32 GetReferenceCount() const
+	{
+		// The cache holds one reference itself
+		return _entry ? _entry.use_count() - 1 : 0;
+	}
+
+	void Reset()
+	{
+		_entry.reset();
+	}
+
+private:
+
+	template<class U>
+	friend class ResourceCache;
+
+	ResourceHandle(std::shared_ptr<ResourceEntry<T>> entry) :
+	_entry(std::move(entry))
+	{
+		_entry->Touch();
+	}
+
+private:
+
+	std::shared_ptr<ResourceEntry<T>> _entry;
+};
+
+// Loader threads decode, uploads are queued back to the main thread and drained a few per frame
+class AsyncLoader
+{
+public:
+
+	void PushLoad(std::function<void ()> task);
+	void PushUpload(std::function<void ()> upload);
+
+	// Returns how many uploads were run
+	u32 ProcessUploads(const u32 maxUploads);
+
+	// Blocks until every load has been decoded and uploaded
+	void Wait();
+
+private:
+
+	std::mutex _mutex;
+	std::deque<std::function<void ()>> _uploads;
+
+	// Last so its threads are joined before the queue goes away
+	ThreadPool _pool;
+};
+
+struct CacheStats
+{
+	u64 hits = 0;
+	u64 misses = 0;
+	u64 evictions = 0;
+
+	u64 memory = 0;
+	u64 budget = 0;
+	u32 count = 0;
+};
 
 class Cache
 {
 public:
 
 	virtual ~Cache() = default;
+
+	// 0 means unlimited
+	void SetBudget(const u64 bytes)
+	{
+		_budget = bytes;
+	}
+
+	virtual CacheStats GetStats() const = 0;
+	virtual u64 GetMemoryUsage() const = 0;
+
+	// Evicts unreferenced resources least recently used first until under the cache budget
+	virtual void Trim() = 0;
+
+	// Reloads resources whose source file changed, returns how many were reloaded
+	virtual u32 ReloadChanged() = 0;
+
+	// Frame the least recently used evictable resource was last used at, max_u64 if there is none
+	virtual u64 GetOldestUse() const = 0;
+	virtual bool EvictOldest() = 0;
+
+protected:
+
+	friend class ResourceManager;
+
+	AsyncLoader* _loader = nullptr;
+
+	u64 _budget = 0;
+
+	// Source file write times are only recorded while hot reloading
+	bool _watchFiles = false;
 };
 
 template<class T>
@@ -23,52 +335,404 @@ public:
 
 	ResourceCache(const std::function<T (const char*)>& loadFunction, const std::function<void (T)>& unloadFunction) :
 	_loadFunction(loadFunction),
-	_unloadFunction(unloadFunction)
+	_shared(std::make_shared<ResourceShared<T>>())
 	{
-
+		_shared->unload = unloadFunction;
 	}
 
 	~ResourceCache()
 	{
-		for (auto& [path, object] : _map)
+		for (auto& [id, entry] : _map)
 		{
-			_unloadFunction(*object);
+			entry->Release();
 		}
 	}
 
-	T& Get(const char* path)
+	// Splits loading in a decode step run on a loader thread and an upload step run on the main thread
+	template<typename Decode, typename Upload>
+	void SetAsyncFunctions(Decode decodeFunction, Upload uploadFunction)
 	{
-		auto it = _map.find(path);
+		using Data = std::invoke_result_t<Decode, const char*>;
+
+		_decodeFunction = [decodeFunction, uploadFunction](const char* path) -> std::function<T ()>
+		{
+			auto data = std::make_shared<Data>(decodeFunction(path));
+
+			return [data, uploadFunction]()
+			{
+				return uploadFunction(*data);
+			};
+		};
+	}
+
+	// Bytes a resource uses, without it resources don't count against budgets
+	void SetSizeFunction(const std::function<u64 (const T&)>& sizeFunction)
+	{
+		_shared->size = sizeFunction;
+	}
+
+	// Blocks if the resource is not loaded yet, the id must have been interned if it was never loaded
+	// The resource is pinned in memory as the returned reference can't be tracked, use handles for evictable resources
+	T& Get(const ResourceId id)
+	{
+		auto it = _map.find(id);
 		if (it != _map.end())
 		{
-			return *it->second();
+			_stats.hits++;
+
+			ResourceEntry<T>& entry = *it->second;
+			if (entry.state != ResourceState::Ready)
+			{
+				entry.Wait();
+			}
+
+			entry.pinned = true;
+			entry.Touch();
+
+			return *entry.object;
+		}
+
+		_stats.misses++;
+
+		const std::string& path = ResourceId::GetPath(id);
+		Assert(!path.empty(), "Resource id was never interned");
+
+		auto entry = CreateEntry();
+		entry->pinned = true;
+		entry->SetObject(_loadFunction(path.c_str()));
+		entry->Touch();
+
+		if (_watchFiles)
+		{
+			entry->writeTime = GetWriteTime(path);
 		}
 
-		auto ptr = std::make_unique<T>(_loadFunction(path));
-		auto& ref = *ptr;
+		auto& ref = *entry->object;
 
-		_map.emplace(path, std::move(ptr));
+		_map.emplace(id, std::move(entry));
 
 		return ref;
 	}
 
-	void Remove(const char* path)
+	T& Get(const std::string_view path)
+	{
+		const ResourceId id(path);
+		if (!_map.contains(id))
+		{
+			ResourceId::Intern(path);
+		}
+
+		return Get(id);
+	}
+
+	// Returns straight away, the handle becomes ready once the main thread uploads it
+	ResourceHandle<T> LoadAsync(const ResourceId id)
+	{
+		auto it = _map.find(id);
+		if (it != _map.end())
+		{
+			_stats.hits++;
+
+			return ResourceHandle<T>(it->second);
+		}
+
+		_stats.misses++;
+
+		Assert(_loader, "Cache must be added through a ResourceManager to load asynchronously");
+
+		const std::string& path = ResourceId::GetPath(id);
+		Assert(!path.empty(), "Resource id was never interned");
+
+		auto entry = CreateEntry();
+
+		if (_watchFiles)
+		{
+			entry->writeTime = GetWriteTime(path);
+		}
+
+		_map.emplace(id, entry);
+
+		AsyncLoader* loader = _loader;
+
+		// Without a decode step the whole load happens during the upload
+		if (!_decodeFunction)
+		{
+			entry->upload = [loadFunction = _loadFunction, &path]()
+			{
+				return loadFunction(path.c_str());
+			};
+			entry->state = ResourceState::Decoded;
+
+			loader->PushUpload([entry]()
+			{
+				entry->Finish();
+			});
+
+			return ResourceHandle<T>(entry);
+		}
+
+		loader->PushLoad([entry, loader, decodeFunction = _decodeFunction, &path]()
+		{
+			std::function<T ()> upload = decodeFunction(path.c_str());
+
+			{
+				std::lock_guard<std::mutex> lock(entry->mutex);
+				entry->upload = std::move(upload);
+				entry->state = ResourceState::Decoded;
+			}
+
+			entry->decoded.notify_all();
+
+			loader->PushUpload([entry]()
+			{
+				entry->Finish();
+			});
+		});
+
+		return ResourceHandle<T>(entry);
+	}
+
+	ResourceHandle<T> LoadAsync(const std::string_view path)
+	{
+		const ResourceId id(path);
+		if (!_map.contains(id))
+		{
+			ResourceId::Intern(path);
+		}
+
+		return LoadAsync(id);
+	}
+
+	// Adds a resource that wasn't loaded from a file, replacing any existing one
+	// Inserted resources can't be reloaded so they are never evicted
+	// Handles to a replaced resource become stale
+	ResourceHandle<T> Insert(const ResourceId id, T object)
+	{
+		Remove(id);
+
+		auto entry = CreateEntry();
+		entry->pinned = true;
+		entry->SetObject(object);
+		entry->Touch();
+
+		_map.emplace(id, entry);
+
+		return ResourceHandle<T>(entry);
+	}
+
+	ResourceHandle<T> Insert(const std::string_view path, T object)
 	{
-		auto it = _map.find(path);
+		return Insert(ResourceId::Intern(path), object);
+	}
+
+	// Swaps a ready resource in place, existing handles see the new one
+	void Replace(const ResourceId id, T object)
+	{
+		auto it = _map.find(id);
+		Assert(it != _map.end() && it->second->state == ResourceState::Ready, "Only loaded resources can be replaced");
+
+		it->second->Replace(object);
+	}
+
+	// Blocks until loaded, unlike Get the resource is not pinned
+	ResourceHandle<T> GetHandle(const ResourceId id)
+	{
+		ResourceHandle<T> handle = LoadAsync(id);
+		handle.Wait();
+
+		return handle;
+	}
+
+	ResourceHandle<T> GetHandle(const std::string_view path)
+	{
+		ResourceHandle<T> handle = LoadAsync(path);
+		handle.Wait();
+
+		return handle;
+	}
+
+	bool Contains(const ResourceId id) const
+	{
+		return _map.contains(id);
+	}
+
+	bool Contains(const std::string_view path) const
+	{
+		return Contains(ResourceId(path));
+	}
+
+	void Remove(const ResourceId id)
+	{
+		auto it = _map.find(id);
 		if (it != _map.end())
 		{
-			_unloadFunction(*it->second);
+			it->second->Release();
 
 			_map.erase(it);
 		}
 	}
 
+	void Remove(const std::string_view path)
+	{
+		Remove(ResourceId(path));
+	}
+
+	CacheStats GetStats() const override
+	{
+		CacheStats stats = _stats;
+		stats.memory = _shared->memory;
+		stats.budget = _budget;
+		stats.count = _map.size();
+
+		return stats;
+	}
+
+	u64 GetMemoryUsage() const override
+	{
+		return _shared->memory;
+	}
+
+	void Trim() override
+	{
+		if (!_budget || _shared->memory <= _budget)
+		{
+			return;
+		}
+
+		std::vector<std::pair<u64, ResourceId>> candidates;
+		for (const auto& [id, entry] : _map)
+		{
+			if (IsEvictable(entry))
+			{
+				candidates.emplace_back(entry->lastUsed.load(std::memory_order_relaxed), id);
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b)
+		{
+			return a.first < b.first;
+		});
+
+		for (const auto& [lastUsed, id] : candidates)
+		{
+			if (_shared->memory <= _budget)
+			{
+				break;
+			}
+
+			Evict(id);
+		}
+	}
+
+	u32 ReloadChanged() override
+	{
+		u32 count = 0;
+
+		for (auto& [id, entry] : _map)
+		{
+			if (!entry->writeTime || entry->state != ResourceState::Ready || !entry->object)
+			{
+				continue;
+			}
+
+			const std::string& path = ResourceId::GetPath(id);
+
+			const std::optional<std::filesystem::file_time_type> writeTime = GetWriteTime(path);
+			if (!writeTime || *writeTime == *entry->writeTime)
+			{
+				continue;
+			}
+
+			entry->writeTime = writeTime;
+			entry->Replace(_loadFunction(path.c_str()));
+
+			count++;
+		}
+
+		return count;
+	}
+
+	u64 GetOldestUse() const override
+	{
+		u64 oldest = max_u64;
+		for (const auto& [id, entry] : _map)
+		{
+			if (IsEvictable(entry))
+			{
+				oldest = std::min(oldest, entry->lastUsed.load(std::memory_order_relaxed));
+			}
+		}
+
+		return oldest;
+	}
+
+	bool EvictOldest() override
+	{
+		auto oldest = _map.end();
+		for (auto it = _map.begin(); it != _map.end(); it++)
+		{
+			if (IsEvictable(it->second) && (oldest == _map.end() || it->second->lastUsed < oldest->second->lastUsed))
+			{
+				oldest = it;
+			}
+		}
+
+		if (oldest == _map.end())
+		{
+			return false;
+		}
+
+		Evict(oldest->first);
+
+		return true;
+	}
+
+private:
+
+	static std::optional<std::filesystem::file_time_type> GetWriteTime(const std::string& path)
+	{
+		std::error_code error;
+		const std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+
+		if (error)
+		{
+			return std::nullopt;
+		}
+
+		return time;
+	}
+
+	std::shared_ptr<ResourceEntry<T>> CreateEntry()
+	{
+		auto entry = std::make_shared<ResourceEntry<T>>();
+		entry->shared = _shared;
+
+		return entry;
+	}
+
+	// Only ready resources that take up memory and nobody holds a handle to
+	bool IsEvictable(const std::shared_ptr<ResourceEntry<T>>& entry) const
+	{
+		return entry.use_count() == 1 && entry->state == ResourceState::Ready && !entry->pinned && entry->size;
+	}
+
+	void Evict(const ResourceId id)
+	{
+		_stats.evictions++;
+
+		Remove(id);
+	}
+
 private:
 
-	std::unordered_map<std::string, std::unique_ptr<T>> _map;
+	std::unordered_map<ResourceId, std::shared_ptr<ResourceEntry<T>>, ResourceId::Hasher> _map;
+
+	std::function<T (const char*)> _loadFunction;
+	std::function<std::function<T ()> (const char*)> _decodeFunction;
 
-	std::function<T(const char*)> _loadFunction;
-	std::function<void (T)> _unloadFunction;
+	std::shared_ptr<ResourceShared<T>> _shared;
+
+	CacheStats _stats;
 };
 
 class ResourceManager
@@ -78,10 +742,20 @@ public:
 	template<typename T, typename... Args>
 	ResourceCache<T>& AddCache(Args&&... args)
 	{
+		Assert(!HasCache<T>(), "A cache already exists holding type ", typeid(T).name());
+
+		const u32 index = CacheIndex<T>();
+		if (index >= _caches.size())
+		{
+			_caches.resize(index + 1);
+		}
+
 		auto ptr = std::make_unique<ResourceCache<T>>(std::forward<Args>(args)...);
 		ResourceCache<T>& ref = *ptr;
+		ref._loader = &_loader;
+		ref._watchFiles = _hotReload;
 
-		_caches.emplace(typeid(T), std::move(ptr));
+		_caches[index] = std::move(ptr);
 
 		return ref;
 	}
@@ -89,25 +763,81 @@ public:
 	template<typename T>
 	ResourceCache<T>& GetCache()
 	{
-		auto it = _caches.find(typeid(T));
-		Assert(it != _caches.end(), "No cache exists holding type ", typeid(T).name());
+		Assert(HasCache<T>(), "No cache exists holding type ", typeid(T).name());
+
+		return *static_cast<ResourceCache<T>*>(_caches[CacheIndex<T>()].get());
+	}
+
+	template<typename T>
+	bool HasCache() const
+	{
+		const u32 index = CacheIndex<T>();
 
-		return *static_cast<ResourceCache<T>*>(it->second.get());
+		return index < _caches.size() && _caches[index];
 	}
 
 	template<typename T>
 	void RemoveCache()
 	{
-		auto it = _caches.find(typeid(T));
-		if (it != _caches.end())
+		if (HasCache<T>())
 		{
-			_caches.erase(it);
+			_caches[CacheIndex<T>()].reset();
 		}
 	}
 
+	// Called once per frame on the main thread to run queued uploads and enforce budgets
+	void Update();
+
+	// Blocks until every pending asynchronous load is ready
+	void WaitForLoads();
+
+	void SetUploadsPerFrame(const u32 count);
+
+	// Budget over all caches together, 0 means unlimited
+	void SetBudget(const u64 bytes);
+
+	u64 GetMemoryUsage() const;
+
+	// Polls the source files of loaded resources and reloads changed ones between frames
+	// Loose files take precedence over the pack while enabled, only resources loaded afterwards are watched
+	void SetHotReload(const bool enabled, const float interval = 0.5);
+
+	// Load functions read through the pack, which falls back to loose files for anything it doesn't hold
+	bool MountPack(const char* path);
+	AssetPack& GetPack();
+
 	void ClearCaches();
 
 private:
 
-	std::unordered_map<std::type_index, std::unique_ptr<Cache>> _caches;
+	// Evicts least recently used resources across every cache until under the global budget
+	void Trim();
+
+	// Each type gets a fixed slot the first time it is used
+	template<typename T>
+	static u32 CacheIndex()
+	{
+		static const u32 index = _nextCacheIndex++;
+
+		return index;
+	}
+
+private:
+
+	inline static std::atomic<u32> _nextCacheIndex = 0;
+
+	// Declared before the caches so in flight loads can still finish while they are destroyed
+	AsyncLoader _loader;
+	u32 _uploadsPerFrame = 4;
+
+	u64 _budget = 0;
+
+	bool _hotReload = false;
+	std::chrono::steady_clock::duration _hotReloadInterval;
+	std::chrono::steady_clock::time_point _lastReloadCheck;
+
+	// Outlives the caches as their resources may point into it
+	AssetPack _pack;
+
+	std::vector<std::unique_ptr<Cache>> _caches;
 };
\ No newline at end of file
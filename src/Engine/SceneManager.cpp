@@ -2,27 +2,73 @@
 
 #include "Assert.h"
 
+#include <algorithm>
+
 void SceneManager::Update(const float deltaT)
 {
-	if (_currentScene)
+	_iterating = true;
+
+	for (const u32 index : _updateLayers)
 	{
-		_currentScene->Update(deltaT);
+		Layer& layer = _stack[index];
+
+		if (layer.tickInterval <= 0)
+		{
+			layer.scene->Update(deltaT);
+
+			continue;
+		}
+
+		layer.accumulator += deltaT;
+		if (layer.accumulator >= layer.tickInterval)
+		{
+			layer.scene->Update(layer.accumulator);
+			layer.accumulator = 0;
+		}
 	}
+
+	_iterating = false;
+
+	ApplyPending();
 }
 
 void SceneManager::Draw()
 {
-	if (_currentScene)
+	_iterating = true;
+
+	for (const u32 index : _drawLayers)
 	{
-		_currentScene->Draw();
+		_stack[index].scene->Draw();
 	}
+
+	_iterating = false;
+
+	ApplyPending();
 }
 
 void SceneManager::RemoveScene(const char* name)
 {
+	if (Defer(Operation::Remove, name))
+	{
+		return;
+	}
+
 	auto it = _scenes.find(name);
 	if (it != _scenes.end())
 	{
+		auto layerIt = std::find_if(_stack.begin(), _stack.end(), [&](const Layer& layer)
+		{
+			return layer.scene == it->second.get();
+		});
+
+		if (layerIt != _stack.end())
+		{
+			layerIt->scene->OnExit();
+			_stack.erase(layerIt);
+
+			RebuildActiveLayers();
+		}
+
 		_scenes.erase(it);
 	}
 }
@@ -32,17 +78,166 @@ void SceneManager::ChangeScene(const char* name)
 	auto it = _scenes.find(name);
 	Assert(it != _scenes.end(), "Scene ", name, " does not exist");
 
-	if (_currentScene)
+	if (Defer(Operation::Change, name))
+	{
+		return;
+	}
+
+	while (!_stack.empty())
+	{
+		_stack.back().scene->OnExit();
+		_stack.pop_back();
+	}
+
+	PushScene(name);
+}
+
+void SceneManager::PushScene(const char* name, const SceneMode mode, const float tickRate)
+{
+	auto it = _scenes.find(name);
+	Assert(it != _scenes.end(), "Scene ", name, " does not exist");
+
+	if (Defer(Operation::Push, name, mode, tickRate))
+	{
+		return;
+	}
+
+	Assert(!IsActive(name), "Scene ", name, " is already in the stack");
+
+	Scene* scene = it->second.get();
+
+	Layer& layer = _stack.emplace_back();
+	layer.name = name;
+	layer.scene = scene;
+	layer.mode = mode;
+	layer.tickInterval = tickRate > 0 ? 1 / tickRate : 0;
+
+	RebuildActiveLayers();
+
+	scene->OnEnter();
+}
+
+void SceneManager::PopScene()
+{
+	if (Defer(Operation::Pop))
+	{
+		return;
+	}
+
+	if (_stack.empty())
+	{
+		return;
+	}
+
+	_stack.back().scene->OnExit();
+	_stack.pop_back();
+
+	RebuildActiveLayers();
+}
+
+void SceneManager::SetSceneMode(const char* name, const SceneMode mode, const float tickRate)
+{
+	if (Defer(Operation::Mode, name, mode, tickRate))
 	{
-		_currentScene->OnExit();
+		return;
 	}
 
-	_currentScene = it->second.get();
+	Layer* layer = FindLayer(name);
+	Assert(layer, "Scene ", name, " is not in the stack");
 
-	_currentScene->OnEnter();
+	layer->mode = mode;
+	layer->tickInterval = tickRate > 0 ? 1 / tickRate : 0;
+	layer->accumulator = 0;
+
+	RebuildActiveLayers();
+}
+
+bool SceneManager::IsActive(const char* name) const
+{
+	return std::any_of(_stack.begin(), _stack.end(), [&](const Layer& layer)
+	{
+		return layer.name == name;
+	});
 }
 
 void SceneManager::SetContext(Context& context)
 {
 	_context = &context;
+}
+
+bool SceneManager::Defer(const Operation operation, const char* name, const SceneMode mode, const float tickRate)
+{
+	if (!_iterating)
+	{
+		return false;
+	}
+
+	_pending.push_back(PendingOperation{operation, name, mode, tickRate});
+
+	return true;
+}
+
+void SceneManager::ApplyPending()
+{
+	// The stack isn't iterating here, so changes scenes make while entering or exiting apply right away instead of being queued
+	for (const PendingOperation& pending : _pending)
+	{
+		switch (pending.operation)
+		{
+			case Operation::Remove: RemoveScene(pending.name.c_str()); break;
+			case Operation::Change: ChangeScene(pending.name.c_str()); break;
+			case Operation::Push: PushScene(pending.name.c_str(), pending.mode, pending.tickRate); break;
+			case Operation::Pop: PopScene(); break;
+			case Operation::Mode: SetSceneMode(pending.name.c_str(), pending.mode, pending.tickRate); break;
+		}
+	}
+
+	_pending.clear();
+}
+
+SceneManager::Layer* SceneManager::FindLayer(const char* name)
+{
+	for (Layer& layer : _stack)
+	{
+		if (layer.name == name)
+		{
+			return &layer;
+		}
+	}
+
+	return nullptr;
+}
+
+void SceneManager::RebuildActiveLayers()
+{
+	_updateLayers.clear();
+	_drawLayers.clear();
+
+	// Drawing starts at the highest visible opaque layer, everything under it is covered
+	u32 firstDrawn = 0;
+	for (u32 i = _stack.size(); i-- > 0;)
+	{
+		const Layer& layer = _stack[i];
+		if (layer.mode != SceneMode::Frozen && layer.scene->IsOpaque())
+		{
+			firstDrawn = i;
+
+			break;
+		}
+	}
+
+	for (u32 i = 0; i < _stack.size(); i++)
+	{
+		const Layer& layer = _stack[i];
+
+		if (layer.mode == SceneMode::Simulate)
+		{
+			_updateLayers.push_back(i);
+		}
+
+		if (layer.mode != SceneMode::Frozen && i >= firstDrawn)
+		{
+			_drawLayers.push_back(i);
+		}
+	}
 }
\ No newline at end of file
@@ -4,9 +4,12 @@
 struct Context;
 
 #include "Assert.h"
+#include "Types.h"
 
+#include <string>
 #include <unordered_map>
 #include <memory>
+#include <vector>
 
 class Scene
 {
@@ -30,11 +33,25 @@ public:
 	virtual void OnEnter() = 0;
 	virtual void OnExit() = 0;
 
+	// An opaque scene fully covers the layers below it so they are not drawn
+	virtual bool IsOpaque() const
+	{
+		return false;
+	}
+
 protected:
 
 	const Context& _context;
 };
 
+// How a layer in the scene stack is treated each frame
+enum class SceneMode
+{
+	Simulate, // Updated and drawn
+	DrawOnly, // Drawn but not updated
+	Frozen, // Neither updated nor drawn
+};
+
 class SceneManager
 {
 public:
@@ -57,15 +74,74 @@ public:
 	}
 
 	void RemoveScene(const char* name);
+
+	// Replaces the whole stack with a single scene
 	void ChangeScene(const char* name);
 
+	// Adds a scene on top of the stack, a tick rate of 0 updates every tick
+	void PushScene(const char* name, const SceneMode mode = SceneMode::Simulate, const float tickRate = 0);
+	void PopScene();
+
+	void SetSceneMode(const char* name, const SceneMode mode, const float tickRate = 0);
+
+	bool IsActive(const char* name) const;
+
 	void SetContext(Context& context);
 
+private:
+
+	struct Layer
+	{
+		std::string name;
+		Scene* scene = nullptr;
+
+		SceneMode mode = SceneMode::Simulate;
+
+		// Throttled layers accumulate time until the interval passes
+		float tickInterval = 0;
+		float accumulator = 0;
+	};
+
+	enum class Operation
+	{
+		Remove,
+		Change,
+		Push,
+		Pop,
+		Mode,
+	};
+
+	struct PendingOperation
+	{
+		Operation operation;
+		std::string name;
+		SceneMode mode = SceneMode::Simulate;
+		float tickRate = 0;
+	};
+
+	Layer* FindLayer(const char* name);
+
+	// Stack changes made while the stack updates or draws are queued and applied once it finishes, returns true when queued
+	bool Defer(const Operation operation, const char* name = "", const SceneMode mode = SceneMode::Simulate, const float tickRate = 0);
+	void ApplyPending();
+
+	// Rebuilds the per frame update and draw lists after the stack changes
+	void RebuildActiveLayers();
+
 private:
 
 	Context* _context = nullptr;
 
-	Scene* _currentScene = nullptr;
+	// Bottom first
+	std::vector<Layer> _stack;
+
+	// Indices into the stack so frozen and covered layers are never visited
+	std::vector<u32> _updateLayers;
+	std::vector<u32> _drawLayers;
+
+	// Set while walking the lists above, which stack changes would invalidate
+	bool _iterating = false;
+	std::vector<PendingOperation> _pending;
 
 	std::unordered_map<std::string, std::unique_ptr<Scene>> _scenes;
 };
\ No newline at end of file
@@ -2,9 +2,39 @@
 
 void SystemManager::Update(const float deltaT)
 {
+	_updating = true;
+
+	// Nothing is added to or erased from the list until the loop is done
 	for (auto& pair : _systems)
 	{
-		pair.second->Update(deltaT);
+		if (!IsRemoved(pair.second.get()))
+		{
+			pair.second->Update(deltaT);
+		}
+	}
+
+	_updating = false;
+
+	for (const System* system : _removed)
+	{
+		RemoveSystem(system);
+	}
+
+	_removed.clear();
+
+	if (!_added.empty())
+	{
+		for (auto& pair : _added)
+		{
+			_systems.push_back(std::move(pair));
+		}
+
+		_added.clear();
+
+		std::stable_sort(_systems.begin(), _systems.end(), [](const auto& a, const auto& b)
+		{
+			return a.first < b.first;
+		});
 	}
 }
 
@@ -16,6 +46,31 @@ void SystemManager::Draw()
 	}
 }
 
+void SystemManager::RemoveSystem(const System* system)
+{
+	if (_updating)
+	{
+		_removed.push_back(system);
+
+		return;
+	}
+
+	std::erase_if(_added, [system](const auto& pair)
+	{
+		return pair.second.get() == system;
+	});
+
+	std::erase_if(_systems, [system](const auto& pair)
+	{
+		return pair.second.get() == system;
+	});
+}
+
+bool SystemManager::IsRemoved(const System* system) const
+{
+	return !_removed.empty() && std::find(_removed.begin(), _removed.end(), system) != _removed.end();
+}
+
 void SystemManager::SetContext(Context& context)
 {
 	_context = &context;
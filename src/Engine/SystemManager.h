@@ -53,9 +53,18 @@ public:
 		auto ptr = std::make_unique<T>(*_context, std::forward<Args>(args)...);
 		T& ref = *ptr;
 
+		// Added once the systems finished updating, a system can add others from its own update
+		if (_updating)
+		{
+			_added.push_back(std::make_pair(priority, std::move(ptr)));
+
+			return ref;
+		}
+
 		_systems.push_back(std::make_pair(priority, std::move(ptr)));
 
-		std::sort(_systems.begin(), _systems.end(), [](const auto& a, const auto& b)
+		// Stable so systems with the same priority run in the order they were added
+		std::stable_sort(_systems.begin(), _systems.end(), [](const auto& a, const auto& b)
 		{
 			return a.first < b.first;
 		});
@@ -63,11 +72,22 @@ public:
 		return ref;
 	}
 
+	// While the systems are updating it stops being updated at once and is destroyed after
+	void RemoveSystem(const System* system);
+
 	void SetContext(Context& context);
 
+private:
+
+	bool IsRemoved(const System* system) const;
+
 private:
 
 	Context* _context = nullptr;
 
+	bool _updating = false;
+	std::vector<std::pair<u32, std::unique_ptr<System>>> _added;
+	std::vector<const System*> _removed;
+
 	std::vector<std::pair<u32, std::unique_ptr<System>>> _systems;
 };
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "TextureAtlas.h"
+
+#include "ResourceManager.h"
+
+#include "Assert.h"
+#include "Log/Log.h"
+
+#include <algorithm>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+#define STB_RECT_PACK_IMPLEMENTATION
+#define STBRP_STATIC
+#include "rlImGui/imstb_rectpack.h"
+
+#pragma GCC diagnostic pop
+
+TextureAtlas::TextureAtlas()
+{
+	static u32 atlasCount = 0;
+
+	_name = "atlas" + std::to_string(atlasCount++);
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	UnloadPages();
+}
+
+void TextureAtlas::Add(const ResourceId id)
+{
+	if (std::find(_images.begin(), _images.end(), id) == _images.end())
+	{
+		_images.push_back(id);
+	}
+}
+
+bool TextureAtlas::Build(ResourceManager& resourceManager)
+{
+	_regions.clear();
+
+	// Sprites copied their regions, the pages they point at stay until the last of them lets go
+	for (u32 i = 0; i < _pages.size(); i++)
+	{
+		_retiredPages.push_back(Page{_pageIds[i], _pages[i]});
+	}
+
+	_pages.clear();
+	_pageIds.clear();
+	_buildCount++;
+
+	_resourceManager = &resourceManager;
+
+	ReleaseRetiredPages();
+
+	if (_images.empty())
+	{
+		return true;
+	}
+
+	ResourceCache<Image>& images = resourceManager.GetCache<Image>();
+
+	// Only held while building, Get would pin every source image in memory for good
+	std::vector<ResourceHandle<Image>> handles;
+	handles.reserve(_images.size());
+
+	std::vector<stbrp_rect> rects(_images.size());
+	u64 area = 0;
+
+	for (u32 i = 0; i < _images.size(); i++)
+	{
+		handles.push_back(images.GetHandle(_images[i]));
+		const Image& image = handles.back().Wait();
+
+		rects[i].id = i;
+		rects[i].w = image.width + _padding;
+		rects[i].h = image.height + _padding;
+
+		if ((u32)rects[i].w > _maxPageSize || (u32)rects[i].h > _maxPageSize)
+		{
+			LogColor(LOG_YELLOW, "Image ", ResourceId::GetPath(_images[i]), " does not fit in an atlas page of ", _maxPageSize);
+
+			return false;
+		}
+
+		area += (u64)rects[i].w * rects[i].h;
+	}
+
+	// Smallest power of two page that could hold everything, capped to the max size
+	u32 pageSize = 64;
+	while (pageSize < _maxPageSize && (u64)pageSize * pageSize < area)
+	{
+		pageSize *= 2;
+	}
+
+	std::vector<stbrp_node> nodes(_maxPageSize);
+	std::vector<stbrp_rect> remaining = rects;
+
+	while (!remaining.empty())
+	{
+		stbrp_context context;
+		stbrp_init_target(&context, pageSize, pageSize, nodes.data(), nodes.size());
+
+		const bool packedAll = stbrp_pack_rects(&context, remaining.data(), remaining.size());
+
+		// Grow the page rather than start a new one while under the max size
+		if (!packedAll && pageSize < _maxPageSize)
+		{
+			pageSize *= 2;
+
+			continue;
+		}
+
+		const u32 page = _pages.size();
+		Image pageImage = GenImageColor(pageSize, pageSize, BLANK);
+
+		std::vector<stbrp_rect> next;
+		for (const stbrp_rect& rect : remaining)
+		{
+			if (!rect.was_packed)
+			{
+				next.push_back(rect);
+
+				continue;
+			}
+
+			const Image& image = handles[rect.id].Wait();
+			const Rectangle source = {0, 0, (float)image.width, (float)image.height};
+			const Rectangle destination = {(float)rect.x, (float)rect.y, (float)image.width, (float)image.height};
+
+			ImageDraw(&pageImage, image, source, destination, WHITE);
+
+			AtlasRegion& region = _regions[_images[rect.id]];
+			region.rectangle = destination;
+			region.page = page;
+		}
+
+		const ResourceId pageId = ResourceId::Intern(_name + "/build" + std::to_string(_buildCount) + "/page" + std::to_string(page));
+		_pages.push_back(resourceManager.GetCache<Texture2D>().Insert(pageId, LoadTextureFromImage(pageImage)));
+		_pageIds.push_back(pageId);
+		UnloadImage(pageImage);
+
+		remaining = std::move(next);
+	}
+
+	for (auto& [id, region] : _regions)
+	{
+		region.texture = _pages[region.page];
+	}
+
+	return true;
+}
+
+void TextureAtlas::ReleaseRetiredPages()
+{
+	if (_retiredPages.empty() || !_resourceManager || !_resourceManager->HasCache<Texture2D>())
+	{
+		return;
+	}
+
+	ResourceCache<Texture2D>& textures = _resourceManager->GetCache<Texture2D>();
+
+	std::erase_if(_retiredPages, [&textures](const Page& page)
+	{
+		// The cache and this list are the only references left
+		if (page.texture.GetReferenceCount() > 1)
+		{
+			return false;
+		}
+
+		textures.Remove(page.id);
+
+		return true;
+	});
+}
+
+void TextureAtlas::Clear()
+{
+	UnloadPages();
+
+	_images.clear();
+	_regions.clear();
+}
+
+bool TextureAtlas::Contains(const ResourceId id) const
+{
+	return _regions.contains(id);
+}
+
+const AtlasRegion& TextureAtlas::GetRegion(const ResourceId id) const
+{
+	auto it = _regions.find(id);
+	Assert(it != _regions.end(), "Image is not in the atlas");
+
+	return it->second;
+}
+
+u32 TextureAtlas::GetPageCount() const
+{
+	return _pages.size();
+}
+
+const ResourceHandle<Texture2D>& TextureAtlas::GetPage(const u32 page) const
+{
+	Assert(page < _pages.size(), "Atlas page out of range");
+
+	return _pages[page];
+}
+
+void TextureAtlas::SetMaxPageSize(const u32 size)
+{
+	_maxPageSize = size;
+}
+
+void TextureAtlas::SetPadding(const u32 padding)
+{
+	_padding = padding;
+}
+
+void TextureAtlas::UnloadPages()
+{
+	if (_resourceManager && _resourceManager->HasCache<Texture2D>())
+	{
+		ResourceCache<Texture2D>& textures = _resourceManager->GetCache<Texture2D>();
+
+		for (const ResourceId id : _pageIds)
+		{
+			textures.Remove(id);
+		}
+
+		for (const Page& page : _retiredPages)
+		{
+			textures.Remove(page.id);
+		}
+	}
+
+	_pages.clear();
+	_pageIds.clear();
+	_retiredPages.clear();
+}
\ No newline at end of file
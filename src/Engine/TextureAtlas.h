@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Types.h"
+
+#include "ResourceId.h"
+#include "ResourceManager.h"
+
+#include "Raylib/raylib.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct AtlasRegion
+{
+	ResourceHandle<Texture2D> texture;
+	Rectangle rectangle;
+	u32 page = 0;
+};
+
+// Packs images held by the ResourceManager image cache into as few textures as possible
+// so sprites sharing a page draw in one batch
+class TextureAtlas
+{
+public:
+
+	TextureAtlas();
+	~TextureAtlas();
+
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	// Image must be in the image cache by the time Build is called
+	void Add(const ResourceId id);
+
+	// Packs every added image into pages held by the texture cache
+	// Previous pages stay loaded for the sprites still using them and are released once none are left
+	bool Build(ResourceManager& resourceManager);
+
+	// Drops retired pages only the atlas still references, cheap when there are none
+	void ReleaseRetiredPages();
+
+	void Clear();
+
+	bool Contains(const ResourceId id) const;
+	const AtlasRegion& GetRegion(const ResourceId id) const;
+
+	u32 GetPageCount() const;
+	const ResourceHandle<Texture2D>& GetPage(const u32 page) const;
+
+	void SetMaxPageSize(const u32 size);
+	void SetPadding(const u32 padding);
+
+private:
+
+	void UnloadPages();
+
+private:
+
+	struct Page
+	{
+		ResourceId id;
+		ResourceHandle<Texture2D> texture;
+	};
+
+	std::vector<ResourceId> _images;
+	std::unordered_map<ResourceId, AtlasRegion, ResourceId::Hasher> _regions;
+
+	std::vector<ResourceHandle<Texture2D>> _pages;
+	std::vector<ResourceId> _pageIds;
+
+	// Pages from earlier builds that sprites may still draw from
+	std::vector<Page> _retiredPages;
+
+	// Pages are inserted in the texture cache under this name and the build they came from
+	std::string _name;
+	u32 _buildCount = 0;
+	ResourceManager* _resourceManager = nullptr;
+
+	u32 _maxPageSize = 2048;
+	u32 _padding = 2;
+};
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(const u32 threadCount)
+{
+	u32 count = threadCount;
+	if (!count)
+	{
+		count = std::max<u32>(std::thread::hardware_concurrency(), 2) - 1;
+	}
+
+	_threads.reserve(count);
+	for (u32 i = 0; i < count; i++)
+	{
+		_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+
+	_taskAvailable.notify_all();
+
+	for (std::thread& thread : _threads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::Push(std::function<void ()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_tasks.push_back(std::move(task));
+	}
+
+	_taskAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idle.wait(lock, [this]()
+	{
+		return _tasks.empty() && !_activeTasks;
+	});
+}
+
+u32 ThreadPool::GetThreadCount() const
+{
+	return _threads.size();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void ()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_taskAvailable.wait(lock, [this]()
+			{
+				return _stopping || !_tasks.empty();
+			});
+
+			// Remaining tasks are still run so nothing waiting on them hangs
+			if (_tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(_tasks.front());
+			_tasks.pop_front();
+			_activeTasks++;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_activeTasks--;
+
+			if (_tasks.empty() && !_activeTasks)
+			{
+				_idle.notify_all();
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Types.h"
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+class ThreadPool
+{
+public:
+
+	// 0 threads uses one less than the hardware concurrency
+	ThreadPool(const u32 threadCount = 0);
+	~ThreadPool();
+
+	void Push(std::function<void ()> task);
+
+	// Blocks until every pushed task has finished
+	void Wait();
+
+	u32 GetThreadCount() const;
+
+private:
+
+	void WorkerLoop();
+
+private:
+
+	std::vector<std::thread> _threads;
+
+	std::deque<std::function<void ()>> _tasks;
+	u32 _activeTasks = 0;
+
+	std::mutex _mutex;
+	std::condition_variable _taskAvailable;
+	std::condition_variable _idle;
+
+	bool _stopping = false;
+};
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+void TimerWheel::Schedule(const u64 id, const u64 delay)
+{
+	Insert(Timer{id, _time + std::max<u64>(delay, 1)});
+
+	_count++;
+}
+
+void TimerWheel::Advance(const u64 time, std::vector<u64>& due)
+{
+	while (_time < time)
+	{
+		// Nothing waiting, no slot can come due
+		if (!_count)
+		{
+			_time = time;
+
+			return;
+		}
+
+		_time++;
+
+		// Higher levels first so a timer can fall through several levels down to this tick
+		if (!(_time & ((u64(1) << (slotBits * levelCount)) - 1)))
+		{
+			Cascade(_overflow);
+		}
+
+		for (u32 level = levelCount - 1; level > 0; level--)
+		{
+			const u32 shift = slotBits * level;
+			if (!(_time & ((u64(1) << shift) - 1)))
+			{
+				Cascade(_levels[level][(_time >> shift) & slotMask]);
+			}
+		}
+
+		std::vector<Timer>& slot = _levels[0][_time & slotMask];
+		for (const Timer& timer : slot)
+		{
+			due.push_back(timer.id);
+		}
+
+		_count -= slot.size();
+		slot.clear();
+	}
+}
+
+u64 TimerWheel::GetTime() const
+{
+	return _time;
+}
+
+u32 TimerWheel::GetCount() const
+{
+	return _count;
+}
+
+void TimerWheel::Insert(const Timer& timer)
+{
+	for (u32 level = 0; level < levelCount; level++)
+	{
+		const u32 shift = slotBits * level;
+		if ((timer.due >> shift) - (_time >> shift) < slotCount)
+		{
+			_levels[level][(timer.due >> shift) & slotMask].push_back(timer);
+
+			return;
+		}
+	}
+
+	_overflow.push_back(timer);
+}
+
+void TimerWheel::Cascade(std::vector<Timer>& timers)
+{
+	if (timers.empty())
+	{
+		return;
+	}
+
+	// Inserting can land back in the overflow, swap first so nothing is appended to the list being read
+	_cascading.swap(timers);
+
+	for (const Timer& timer : _cascading)
+	{
+		Insert(timer);
+	}
+
+	_cascading.clear();
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Types.h"
+
+#include <array>
+#include <vector>
+
+// Hierarchical timing wheel, scheduling and advancing cost the same however many timers are waiting. Time is in whatever unit Advance is given
+class TimerWheel
+{
+public:
+
+	// Fires once time has moved forward by delay, at least one unit later
+	void Schedule(const u64 id, const u64 delay);
+
+	// Moves time forward to time and appends the ids that came due, in due order
+	void Advance(const u64 time, std::vector<u64>& due);
+
+	u64 GetTime() const;
+	u32 GetCount() const;
+
+private:
+
+	struct Timer
+	{
+		u64 id;
+		u64 due;
+	};
+
+	static constexpr u32 slotBits = 6;
+	static constexpr u32 slotCount = 1 << slotBits;
+	static constexpr u32 slotMask = slotCount - 1;
+	static constexpr u32 levelCount = 4;
+
+	void Insert(const Timer& timer);
+	void Cascade(std::vector<Timer>& timers);
+
+private:
+
+	// Level n holds timers due within slotCount^(n + 1) units, a slot per slotCount^n units
+	std::array<std::array<std::vector<Timer>, slotCount>, levelCount> _levels;
+
+	// Further out than the last level covers, sorted back in every time it wraps
+	std::vector<Timer> _overflow;
+
+	// Swapped with the slot being cascaded so both keep their capacity
+	std::vector<Timer> _cascading;
+
+	u64 _time = 0;
+	u32 _count = 0;
+};
\ No newline at end of file
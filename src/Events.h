@@ -0,0 +1,25 @@
+#pragma once
+
+#include "MyMath/MyVectors.h"
+#include "Types.h"
+
+namespace Event
+{
+	struct FoodEaten
+	{
+		Vector2i position;
+		u32 snakeSize = 0;
+	};
+
+	struct SnakeDied
+	{
+		u32 snakeSize = 0;
+		u32 score = 0;
+	};
+
+	struct ScoreChanged
+	{
+		u32 score = 0;
+		u32 bestScore = 0;
+	};
+}
\ No newline at end of file
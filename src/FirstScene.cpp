@@ -1,6 +1,7 @@
 #include "FirstScene.h"
 
 #include "Engine/Components.h"
+#include "MyRaylib/MyRaylib.h"
 
 #include "Raylib/raylib.h"
 #include <cstdio>
@@ -12,12 +13,57 @@ _grid(context)
 {
 	InitAudioDevice();
 
-	_pickupSound = LoadSound("pickup.wav");
-	_dieSound = LoadSound("die.wav");
+	if (!_context.resourceManager.HasCache<Sound>())
+	{
+		const AssetPack& pack = _context.resourceManager.GetPack();
+
+		auto uploadSound = [&pack](Wave& wave)
+		{
+			Sound sound = LoadSoundFromWave(wave);
+			pack.UnloadWave(wave);
+
+			return sound;
+		};
+
+		auto loadSound = [&pack, uploadSound](const char* path)
+		{
+			Wave wave = pack.LoadWave(path);
+
+			return uploadSound(wave);
+		};
+
+		ResourceCache<Sound>& sounds = _context.resourceManager.AddCache<Sound>(loadSound, UnloadSound);
+		sounds.SetSizeFunction(GetSoundMemorySize);
+
+		// Files are read and decoded on loader threads, only the audio buffer is created on the main thread
+		sounds.SetAsyncFunctions([&pack](const char* path)
+		{
+			return pack.LoadWave(path);
+		}, uploadSound);
+	}
+
+	ResourceCache<Sound>& sounds = _context.resourceManager.GetCache<Sound>();
+	_pickupSound = sounds.LoadAsync("pickup.wav");
+	_dieSound = sounds.LoadAsync("die.wav");
+
+	// Scripts subscribe by these names
+	_context.luaManager.RegisterEvent<Event::FoodEaten>("FoodEaten",
+		"position", &Event::FoodEaten::position,
+		"snakeSize", &Event::FoodEaten::snakeSize);
+
+	_context.luaManager.RegisterEvent<Event::SnakeDied>("SnakeDied",
+		"snakeSize", &Event::SnakeDied::snakeSize,
+		"score", &Event::SnakeDied::score);
+
+	_context.luaManager.RegisterEvent<Event::ScoreChanged>("ScoreChanged",
+		"score", &Event::ScoreChanged::score,
+		"bestScore", &Event::ScoreChanged::bestScore);
 }
 
 FirstScene::~FirstScene() 
 {
+	_context.dispatcher.disconnect(this);
+
 	CloseAudioDevice();
 }
 
@@ -50,14 +96,15 @@ void FirstScene::Update(const float deltaT)
 			_score += 10 * (int(_snakeSize / 5) + 1);
 			_maxFood = (int(_snakeSize / 10) + 1);
 
-			PlaySound(_pickupSound);
+			_context.dispatcher.enqueue(Event::FoodEaten{_snake->GetHeadPosition(), _snakeSize});
+			_context.dispatcher.enqueue(Event::ScoreChanged{_score, _bestScore});
 		}
 
 		if (!_snake->Update(deltaT))
 		{
 			Log("Lost");
 
-			PlaySound(_dieSound);
+			_context.dispatcher.enqueue(Event::SnakeDied{_snake->GetSize(), _score});
 
 			Start();
 		}
@@ -73,19 +120,22 @@ void FirstScene::Draw()
 
 void FirstScene::OnEnter()
 {
+	_context.dispatcher.sink<Event::FoodEaten>().connect<&FirstScene::OnFoodEaten>(this);
+	_context.dispatcher.sink<Event::SnakeDied>().connect<&FirstScene::OnSnakeDied>(this);
+
 	Start();
 }
 
 void FirstScene::OnExit()
 {
-
+	_context.dispatcher.disconnect(this);
 }
 
 void FirstScene::Start() 
 {
 	_grid.Reset();
 
-	_snake.emplace(_grid);
+	_snake.emplace(_context, _grid);
 
 	if (_score > _bestScore)
 	{
@@ -93,6 +143,8 @@ void FirstScene::Start()
 	}
 	_score = 0;
 
+	_context.dispatcher.enqueue(Event::ScoreChanged{_score, _bestScore});
+
 	_snakeSize = _snake->GetSize();
 	_foodSpawned = 0;
 	_maxFood = 1;
@@ -118,4 +170,14 @@ bool FirstScene::SpawnFood()
 	}
 
 	return false;
+}
+
+void FirstScene::OnFoodEaten(const Event::FoodEaten&)
+{
+	PlaySound(_pickupSound.Wait());
+}
+
+void FirstScene::OnSnakeDied(const Event::SnakeDied&)
+{
+	PlaySound(_dieSound.Wait());
 }
\ No newline at end of file
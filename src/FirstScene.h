@@ -2,6 +2,7 @@
 
 #include "Engine/Context.h"
 
+#include "Events.h"
 #include "Grid.h"
 #include "Snake.h"
 
@@ -25,6 +26,10 @@ private:
 	void Start();
 	bool SpawnFood();
 
+	// Event handeling
+	void OnFoodEaten(const Event::FoodEaten& event);
+	void OnSnakeDied(const Event::SnakeDied& event);
+
 private:
 
 	Grid _grid;
@@ -37,6 +42,6 @@ private:
 	u32 _score = 0;
 	u32 _bestScore = 0;
 
-	Sound _pickupSound;
-	Sound _dieSound;
+	ResourceHandle<Sound> _pickupSound;
+	ResourceHandle<Sound> _dieSound;
 };
\ No newline at end of file
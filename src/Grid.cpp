@@ -3,6 +3,7 @@
 #include "Assert.h"
 
 #include "Engine/Components.h"
+#include "Engine/ProceduralImage.h"
 #include "Components.h"
 
 #include "Raylib/raylib.h"
@@ -18,15 +19,33 @@ _context(context)
 	_gridSize = GetScreenWidth() / _size;
 	_grid.resize(_size, _size, entt::null);
 
-	Image snakeImage = GenImageColor(_gridSize, _gridSize, BLANK);
-	ImageDrawRectangleRounded(&snakeImage, {2.5, 2.5, _gridSize - 2.5, _gridSize - 2.5}, 0.2, GREEN);
-	_snakeTexture = LoadTextureFromImage(snakeImage);
-	UnloadImage(snakeImage);
+	// Generated once per cell size and shared by every board using it
+	ProceduralImageDesc snakeDesc;
+	snakeDesc.shape = ProceduralShape::RoundedRectangle;
+	snakeDesc.size = _gridSize;
+	snakeDesc.color = GREEN;
+	snakeDesc.roundness = 0.2;
+	snakeDesc.margin = 2.5;
+
+	ProceduralImageDesc foodDesc;
+	foodDesc.shape = ProceduralShape::Circle;
+	foodDesc.size = _gridSize;
+	foodDesc.color = RED;
+
+	const ResourceId snakeId = Procedural::GetImage(_context.resourceManager, snakeDesc);
+	const ResourceId foodId = Procedural::GetImage(_context.resourceManager, foodDesc);
+
+	// Both go in the shared atlas so every cell draws from the same texture
+	TextureAtlas& atlas = _context.renderer.atlas;
+	if (!atlas.Contains(snakeId) || !atlas.Contains(foodId))
+	{
+		atlas.Add(snakeId);
+		atlas.Add(foodId);
+		atlas.Build(_context.resourceManager);
+	}
 
-	Image foodImage = GenImageColor(_gridSize, _gridSize, BLANK);
-	ImageDrawCircleV(&foodImage, {_gridSize / 2, _gridSize / 2}, _gridSize / 2, RED);
-	_foodTexture = LoadTextureFromImage(foodImage);
-	UnloadImage(foodImage);
+	_snakeRegion = atlas.GetRegion(snakeId);
+	_foodRegion = atlas.GetRegion(foodId);
 }
 
 bool Grid::IsSnake(const Vector2i position)
@@ -66,7 +85,7 @@ void Grid::SpawnSnake(const Vector2i position)
 	_grid[position.x, position.y] = entity;
 	_context.registry.emplace<Component::Snake>(entity, true, false);
 	_context.registry.emplace<Component::Transform>(entity, Vector2f{position.x * _gridSize + _gridSize / 2, position.y * _gridSize + _gridSize / 2});
-	_context.registry.emplace<Component::Sprite>(entity, _snakeTexture, Rectangle{0, 0, _gridSize, _gridSize});
+	_context.registry.emplace<Component::Sprite>(entity, _snakeRegion.texture, _snakeRegion.rectangle);
 }
 
 void Grid::SpawnFood(const Vector2i position)
@@ -80,7 +99,7 @@ void Grid::SpawnFood(const Vector2i position)
 	_grid[position.x, position.y] = entity;
 	_context.registry.emplace<Component::Snake>(entity, false, true);
 	_context.registry.emplace<Component::Transform>(entity, Vector2f{position.x * _gridSize + _gridSize / 2, position.y * _gridSize + _gridSize / 2});
-	_context.registry.emplace<Component::Sprite>(entity, _foodTexture, Rectangle{0, 0, _gridSize, _gridSize});
+	_context.registry.emplace<Component::Sprite>(entity, _foodRegion.texture, _foodRegion.rectangle);
 }
 
 void Grid::ClearCell(const Vector2i position) 
@@ -115,22 +134,4 @@ void Grid::Reset()
 	{
 		_context.registry.destroy(entity);
 	}
-}
-
-void Grid::ImageDrawRectangleRounded(Image* img, Rectangle rec, const float roundness, Color color)
-{
-    float r = roundness * (rec.width < rec.height ? rec.width : rec.height);
-
-    ImageDrawRectangleRec(img, {rec.x + r, rec.y, rec.width - 2*r, rec.height}, color);
-    ImageDrawRectangleRec(img, {rec.x, rec.y + r, rec.width, rec.height - 2*r}, color);
-
-    Vector2 tl = { rec.x + r, rec.y + r };
-    Vector2 tr = { rec.x + rec.width - r, rec.y + r };
-    Vector2 bl = { rec.x + r, rec.y + rec.height - r };
-    Vector2 br = { rec.x + rec.width - r, rec.y + rec.height - r };
-
-    ImageDrawCircleV(img, tl, r, color);
-    ImageDrawCircleV(img, tr, r, color);
-    ImageDrawCircleV(img, bl, r, color);
-    ImageDrawCircleV(img, br, r, color);
 }
\ No newline at end of file
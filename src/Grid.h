@@ -23,10 +23,6 @@ public:
 
 	void Reset();
 
-private:
-
-	void ImageDrawRectangleRounded(Image* img, Rectangle rec, const float roundness, Color color);
-
 private:
 
 	const Context& _context;
@@ -35,6 +31,6 @@ private:
 	u32 _size;
 	u32 _gridSize;
 
-	Texture2D _snakeTexture;
-	Texture2D _foodTexture;
+	AtlasRegion _snakeRegion;
+	AtlasRegion _foodRegion;
 };
\ No newline at end of file
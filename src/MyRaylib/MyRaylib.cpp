@@ -5,6 +5,7 @@
 
 #include "Log/Log.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
@@ -433,6 +434,36 @@ Rectangle CenteredRectangle(const Rectangle rec, const Vector2 pos)
     return Rectangle{pos.x - (rec.width / 2), pos.y - (rec.height / 2), rec.width, rec.height};
 }
 
+static u64 GetMipmapsMemorySize(int width, int height, const int mipmaps, const int format)
+{
+    u64 size = 0;
+
+    for (int i = 0; i < std::max(mipmaps, 1); i++)
+    {
+        size += GetPixelDataSize(width, height, format);
+
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+
+    return size;
+}
+
+u64 GetTextureMemorySize(const Texture2D& texture)
+{
+    return GetMipmapsMemorySize(texture.width, texture.height, texture.mipmaps, texture.format);
+}
+
+u64 GetImageMemorySize(const Image& image)
+{
+    return GetMipmapsMemorySize(image.width, image.height, image.mipmaps, image.format);
+}
+
+u64 GetSoundMemorySize(const Sound& sound)
+{
+    return (u64)sound.frameCount * sound.stream.channels * sound.stream.sampleSize / 8;
+}
+
 RenderTexture2D LoadShadowmapRenderTexture(int width, int height)
 {
     RenderTexture2D target = { 0 };
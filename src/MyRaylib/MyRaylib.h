@@ -2,6 +2,8 @@
 #include "Raylib/raylib.h"
 #include "Raylib/rlgl.h"
 
+#include "Types.h"
+
 #include <string>
 #include <vector>
 #include <cmath>
@@ -157,6 +159,11 @@ std::string DoubleToRoundedString(const double num, const int precision);
 // Get a centered rectangle
 Rectangle CenteredRectangle(const Rectangle rec, const Vector2 pos);
 
+// Approximate memory a resource takes in bytes, mipmaps included
+u64 GetTextureMemorySize(const Texture2D& texture);
+u64 GetImageMemorySize(const Image& image);
+u64 GetSoundMemorySize(const Sound& sound);
+
 // Used for shadowmaps
 RenderTexture2D LoadShadowmapRenderTexture(int width, int height);
 void UnloadShadowmapRenderTexture(RenderTexture2D target);
\ No newline at end of file
@@ -3,7 +3,8 @@
 #include "Grid.h"
 #include "MyMath/MyVectors.h"
 
-Snake::Snake(Grid& grid) :
+Snake::Snake(const Context& context, Grid& grid) :
+_context(context),
 _grid(grid) 
 {
 	Vector2i headPosition = {GetRandomValue(1, _grid.GetSize() - 1), GetRandomValue(1, _grid.GetSize() -1)};
@@ -60,11 +61,15 @@ bool Snake::Update(const float deltaT)
 
 		if (_grid.IsSnake(nextPosition) && !(nextPosition.x == _positions.back().x && nextPosition.y == _positions.back().y))
 		{
+			LogBinary(_context.logger, LogLevel::INFO, "Snake hit itself at {}, {} with size {}", nextPosition.x, nextPosition.y, GetSize());
+
 			return false;
 		}
 
 		else if (_grid.IsFood(nextPosition))
 		{
+			LogBinary(_context.logger, LogLevel::DEBUG, "Snake ate at {}, {} growing to {}", nextPosition.x, nextPosition.y, GetSize() + 1);
+
 			Grow();
 		}
 
@@ -73,6 +78,8 @@ bool Snake::Update(const float deltaT)
 			MoveSnake(nextPosition);
 		}
 
+		LogBinary(_context.logger, LogLevel::DEBUG, "Snake step to {}, {} heading {}, {} with {} turns queued", nextPosition.x, nextPosition.y, _direction.x, _direction.y, _directions.size());
+
 		accumulator = 0;
 	}
 
@@ -84,6 +91,11 @@ u32 Snake::GetSize()
 	return _positions.size();
 }
 
+Vector2i Snake::GetHeadPosition()
+{
+	return _positions.front();
+}
+
 void Snake::Input() 
 {
     if (IsKeyPressed(KEY_UP) && _directions.size() < 2)
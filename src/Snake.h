@@ -12,11 +12,12 @@ class Snake
 {
 public:
 
-	Snake(Grid& grid);
+	Snake(const Context& context, Grid& grid);
 
 	bool Update(const float deltaT);
 
 	u32 GetSize();
+	Vector2i GetHeadPosition();
 
 private:
 
@@ -32,6 +33,7 @@ private:
 
 private:
 
+	const Context& _context;
 	Grid& _grid;
 
 	Vector2i _direction;
@@ -0,0 +1,407 @@
+// Turns a binary log back into the text the logger would have written
+// Usage: logdecode <log> [--source]
+
+#include "Engine/BinaryLog.h"
+
+#include "Log/Log.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Site
+{
+	u8 level;
+	u32 line;
+	std::string file;
+	std::string format;
+	std::vector<BinaryLog::Argument> arguments;
+};
+
+struct Sync
+{
+	u64 counter;
+	i64 time;
+};
+
+struct Reader
+{
+	const std::vector<u8>& data;
+	size_t position = 0;
+
+	template<typename T>
+	bool Get(T& value)
+	{
+		if (position + sizeof(T) > data.size())
+		{
+			return false;
+		}
+
+		std::memcpy(&value, data.data() + position, sizeof(T));
+		position += sizeof(T);
+
+		return true;
+	}
+
+	bool GetBytes(std::string& text, const size_t size)
+	{
+		if (position + size > data.size())
+		{
+			return false;
+		}
+
+		text.assign(reinterpret_cast<const char*>(data.data() + position), size);
+		position += size;
+
+		return true;
+	}
+
+	bool GetString(std::string& text)
+	{
+		u16 size;
+		return Get(size) && GetBytes(text, size);
+	}
+};
+
+static const char* LevelName(const u8 level)
+{
+	static const char* names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+	return level < std::size(names) ? names[level] : "UNKNOWN";
+}
+
+template<typename T>
+static bool AppendNumber(Reader& reader, std::string& text)
+{
+	T value;
+	if (!reader.Get(value))
+	{
+		return false;
+	}
+
+	char buffer[32];
+	auto [last, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	text.append(buffer, last);
+
+	return true;
+}
+
+static bool AppendArgument(Reader& reader, const BinaryLog::Argument argument, std::string& text)
+{
+	using BinaryLog::Argument;
+
+	switch (argument)
+	{
+		case Argument::Bool:
+		{
+			u8 value;
+			if (!reader.Get(value))
+			{
+				return false;
+			}
+
+			text += value ? '1' : '0';
+
+			return true;
+		}
+
+		case Argument::Char:
+		{
+			char value;
+			if (!reader.Get(value))
+			{
+				return false;
+			}
+
+			text += value;
+
+			return true;
+		}
+
+		case Argument::I8: return AppendNumber<i8>(reader, text);
+		case Argument::U8: return AppendNumber<u8>(reader, text);
+		case Argument::I16: return AppendNumber<i16>(reader, text);
+		case Argument::U16: return AppendNumber<u16>(reader, text);
+		case Argument::I32: return AppendNumber<i32>(reader, text);
+		case Argument::U32: return AppendNumber<u32>(reader, text);
+		case Argument::I64: return AppendNumber<i64>(reader, text);
+		case Argument::U64: return AppendNumber<u64>(reader, text);
+		case Argument::F32: return AppendNumber<f32>(reader, text);
+		case Argument::F64: return AppendNumber<f64>(reader, text);
+
+		case Argument::String:
+		{
+			std::string value;
+			if (!reader.GetString(value))
+			{
+				return false;
+			}
+
+			text += value;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Replaces each {} with the next argument, in order
+static bool FormatRecord(const Site& site, Reader& reader, std::string& text)
+{
+	u32 argument = 0;
+
+	for (size_t i = 0; i < site.format.size(); i++)
+	{
+		if (site.format[i] == '{' && i + 1 < site.format.size() && site.format[i + 1] == '}' && argument < site.arguments.size())
+		{
+			if (!AppendArgument(reader, site.arguments[argument++], text))
+			{
+				return false;
+			}
+
+			i++;
+		}
+
+		else
+		{
+			text += site.format[i];
+		}
+	}
+
+	return true;
+}
+
+// Counters only mean something next to the syncs around them, interpolate between the closest pair
+static i64 GetTime(const std::vector<Sync>& syncs, const u64 counter)
+{
+	if (syncs.size() < 2)
+	{
+		return syncs.empty() ? 0 : syncs.front().time;
+	}
+
+	auto it = std::upper_bound(syncs.begin(), syncs.end(), counter, [](const u64 value, const Sync& sync)
+	{
+		return value < sync.counter;
+	});
+
+	const size_t index = std::clamp<size_t>(it - syncs.begin(), 1, syncs.size() - 1);
+	const Sync& a = syncs[index - 1];
+	const Sync& b = syncs[index];
+
+	if (b.counter == a.counter)
+	{
+		return a.time;
+	}
+
+	const double rate = double(b.time - a.time) / double(b.counter - a.counter);
+
+	return a.time + i64((double(counter) - double(a.counter)) * rate);
+}
+
+static std::string FormatTime(const i64 nanoseconds)
+{
+	const time_t seconds = nanoseconds / 1000000000;
+	const int milliseconds = (nanoseconds / 1000000) % 1000;
+
+	std::tm timeInfo;
+	GetThreadSafeLocalTime(seconds, timeInfo);
+
+	char buffer[16];
+	const size_t size = std::strftime(buffer, sizeof(buffer), "%H:%M:%S", &timeInfo);
+	std::snprintf(buffer + size, sizeof(buffer) - size, ".%03d", milliseconds);
+
+	return buffer;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		OutputErr("Usage: logdecode <log> [--source]");
+
+		return 1;
+	}
+
+	const bool source = argc > 2 && std::strcmp(argv[2], "--source") == 0;
+
+	std::ifstream file(argv[1], std::ios::binary);
+	if (!file)
+	{
+		OutputErr("Failed to open ", argv[1]);
+
+		return 1;
+	}
+
+	const std::vector<u8> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	Reader reader{data};
+
+	BinaryLog::Header header;
+	if (!reader.Get(header) || std::memcmp(header.magic, BinaryLog::magic, sizeof(header.magic)) != 0 || header.version != BinaryLog::version)
+	{
+		OutputErr(argv[1], " is not a binary log this decoder can read");
+
+		return 1;
+	}
+
+	// Syncs can come after the records they time, gather them all before printing anything
+	std::vector<Sync> syncs;
+	std::vector<size_t> entries;
+
+	bool truncated = false;
+
+	while (reader.position < data.size() && !truncated)
+	{
+		entries.push_back(reader.position);
+
+		BinaryLog::EntryType type;
+		reader.Get(type);
+
+		switch (type)
+		{
+			case BinaryLog::EntryType::Site:
+			{
+				u32 id;
+				u8 level;
+				u32 line;
+				std::string text;
+				u8 count;
+				truncated = !reader.Get(id) || !reader.Get(level) || !reader.Get(line) || !reader.GetString(text) || !reader.GetString(text) || !reader.Get(count);
+				reader.position += truncated ? 0 : count;
+
+				break;
+			}
+
+			case BinaryLog::EntryType::Record:
+			{
+				u32 site;
+				u64 counter;
+				u8 size;
+				truncated = !reader.Get(site) || !reader.Get(counter) || !reader.Get(size);
+				reader.position += truncated ? 0 : size;
+
+				break;
+			}
+
+			case BinaryLog::EntryType::Sync:
+			{
+				Sync sync;
+				truncated = !reader.Get(sync.counter) || !reader.Get(sync.time);
+
+				if (!truncated)
+				{
+					syncs.push_back(sync);
+				}
+
+				break;
+			}
+
+			case BinaryLog::EntryType::Dropped:
+			{
+				u64 count;
+				truncated = !reader.Get(count);
+
+				break;
+			}
+
+			default:
+			{
+				truncated = true;
+			}
+		}
+
+		truncated = truncated || reader.position > data.size();
+	}
+
+	if (truncated)
+	{
+		// A log cut short by a crash still decodes up to the last whole entry
+		OutputErrColor(LOG_YELLOW, "Log ends in a partial or unknown entry, decoding what comes before it");
+		entries.pop_back();
+	}
+
+	std::sort(syncs.begin(), syncs.end(), [](const Sync& a, const Sync& b)
+	{
+		return a.counter < b.counter;
+	});
+
+	std::unordered_map<u32, Site> sites;
+	std::string line;
+
+	for (const size_t position : entries)
+	{
+		reader.position = position;
+
+		BinaryLog::EntryType type;
+		reader.Get(type);
+
+		if (type == BinaryLog::EntryType::Site)
+		{
+			u32 id;
+			Site site;
+			u8 count;
+			reader.Get(id);
+			reader.Get(site.level);
+			reader.Get(site.line);
+			reader.GetString(site.file);
+			reader.GetString(site.format);
+			reader.Get(count);
+
+			site.arguments.resize(count);
+			for (BinaryLog::Argument& argument : site.arguments)
+			{
+				reader.Get(argument);
+			}
+
+			sites[id] = std::move(site);
+		}
+
+		else if (type == BinaryLog::EntryType::Record)
+		{
+			u32 id;
+			u64 counter;
+			u8 size;
+			reader.Get(id);
+			reader.Get(counter);
+			reader.Get(size);
+
+			auto it = sites.find(id);
+			if (it == sites.end())
+			{
+				OutputErrColor(LOG_YELLOW, "Record for unknown site ", id);
+
+				continue;
+			}
+
+			const Site& site = it->second;
+
+			line = "[" + FormatTime(GetTime(syncs, counter)) + "] [" + LevelName(site.level) + "] ";
+			if (!FormatRecord(site, reader, line))
+			{
+				line += " <bad arguments>";
+			}
+
+			if (source)
+			{
+				line += " (" + site.file + ":" + std::to_string(site.line) + ")";
+			}
+
+			std::fwrite(line.data(), 1, line.size(), stdout);
+			std::fputc('\n', stdout);
+		}
+
+		else if (type == BinaryLog::EntryType::Dropped)
+		{
+			u64 count;
+			reader.Get(count);
+
+			std::fprintf(stdout, "[WARN] Log full, dropped %llu records\n", static_cast<unsigned long long>(count));
+		}
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,229 @@
+// Builds an asset pack out of a directory of loose files
+// Usage: pack <output> <directory> [--decode] [--alignment n]
+
+#include "Engine/AssetPack.h"
+
+#include "Raylib/raylib.h"
+
+#include "Log/Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct PackFile
+{
+	std::string path;
+	ResourceId id;
+
+	Pack::PayloadType type = Pack::PayloadType::Raw;
+	std::vector<u8> payload;
+};
+
+static bool IsPackable(const std::string& extension)
+{
+	static const char* extensions[] = {".wav", ".ogg", ".mp3", ".png", ".bmp", ".jpg", ".lua"};
+
+	return std::find_if(std::begin(extensions), std::end(extensions), [&](const char* packable)
+	{
+		return extension == packable;
+	}) != std::end(extensions);
+}
+
+static std::vector<u8> ReadFile(const fs::path& path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+	std::vector<u8> data(file.tellg());
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(data.data()), data.size());
+
+	return data;
+}
+
+template<typename H>
+static std::vector<u8> MakePayload(const H& header, const void* data, const u64 size)
+{
+	std::vector<u8> payload(sizeof(H) + size);
+	std::memcpy(payload.data(), &header, sizeof(H));
+	std::memcpy(payload.data() + sizeof(H), data, size);
+
+	return payload;
+}
+
+// Stores samples and pixels decoded so nothing needs decoding at runtime
+static void Decode(PackFile& file, const fs::path& path)
+{
+	const std::string extension = path.extension().string();
+
+	if (extension == ".wav" || extension == ".ogg" || extension == ".mp3")
+	{
+		Wave wave = LoadWave(path.string().c_str());
+		if (!wave.data)
+		{
+			return;
+		}
+
+		Pack::WaveHeader header = {wave.frameCount, wave.sampleRate, wave.sampleSize, wave.channels};
+		file.payload = MakePayload(header, wave.data, Pack::GetWaveDataSize(header));
+		file.type = Pack::PayloadType::Wave;
+
+		UnloadWave(wave);
+	}
+
+	else if (extension == ".png" || extension == ".bmp" || extension == ".jpg")
+	{
+		Image image = LoadImage(path.string().c_str());
+		if (!image.data)
+		{
+			return;
+		}
+
+		Pack::ImageHeader header = {image.width, image.height, image.mipmaps, image.format};
+		file.payload = MakePayload(header, image.data, Pack::GetImageDataSize(header));
+		file.type = Pack::PayloadType::Image;
+
+		UnloadImage(image);
+	}
+}
+
+static u64 Align(const u64 value, const u64 alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		OutputErr("Usage: pack <output> <directory> [--decode] [--alignment n]");
+
+		return 1;
+	}
+
+	const fs::path output = argv[1];
+	const fs::path root = argv[2];
+
+	bool decode = false;
+	u32 alignment = Pack::defaultAlignment;
+
+	for (int i = 3; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--decode") == 0)
+		{
+			decode = true;
+		}
+
+		else if (std::strcmp(argv[i], "--alignment") == 0 && i + 1 < argc)
+		{
+			alignment = std::max(std::stoul(argv[++i]), 1ul);
+		}
+	}
+
+	SetTraceLogLevel(LOG_WARNING);
+
+	std::vector<PackFile> files;
+
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root))
+	{
+		if (!entry.is_regular_file() || !IsPackable(entry.path().extension().string()))
+		{
+			continue;
+		}
+
+		PackFile& file = files.emplace_back();
+		file.path = fs::relative(entry.path(), root).generic_string();
+		file.id = ResourceId(file.path);
+
+		if (decode)
+		{
+			Decode(file, entry.path());
+		}
+
+		if (file.type == Pack::PayloadType::Raw)
+		{
+			file.payload = ReadFile(entry.path());
+		}
+	}
+
+	std::sort(files.begin(), files.end(), [](const PackFile& a, const PackFile& b)
+	{
+		return a.id.hash < b.id.hash;
+	});
+
+	for (u32 i = 1; i < files.size(); i++)
+	{
+		if (files[i].id == files[i - 1].id)
+		{
+			OutputErr("Path hash collision between ", files[i - 1].path, " and ", files[i].path);
+
+			return 1;
+		}
+	}
+
+	// Header, index and path strings come first, payloads follow aligned
+	std::vector<Pack::Entry> entries(files.size());
+
+	u64 offset = sizeof(Pack::Header) + files.size() * sizeof(Pack::Entry);
+	for (u32 i = 0; i < files.size(); i++)
+	{
+		entries[i].id = files[i].id.hash;
+		entries[i].pathOffset = offset;
+		entries[i].pathSize = files[i].path.size();
+		entries[i].type = static_cast<u16>(files[i].type);
+
+		offset += files[i].path.size();
+	}
+
+	for (u32 i = 0; i < files.size(); i++)
+	{
+		offset = Align(offset, alignment);
+
+		entries[i].offset = offset;
+		entries[i].size = files[i].payload.size();
+
+		offset += files[i].payload.size();
+	}
+
+	std::ofstream out(output, std::ios::binary);
+	if (!out)
+	{
+		OutputErr("Failed to open ", output.string());
+
+		return 1;
+	}
+
+	Pack::Header header;
+	std::memcpy(header.magic, Pack::magic, sizeof(Pack::magic));
+	header.version = Pack::version;
+	header.entryCount = files.size();
+	header.alignment = alignment;
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Pack::Entry));
+
+	for (const PackFile& file : files)
+	{
+		out.write(file.path.data(), file.path.size());
+	}
+
+	for (u32 i = 0; i < files.size(); i++)
+	{
+		const u64 padding = entries[i].offset - out.tellp();
+		for (u64 j = 0; j < padding; j++)
+		{
+			out.put(0);
+		}
+
+		out.write(reinterpret_cast<const char*>(files[i].payload.data()), files[i].payload.size());
+	}
+
+	Output("Packed ", files.size(), " files into ", output.string(), " (", offset, " bytes)");
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+// Times LuaManager::Update for entity scripts run one by one through Update and batched through UpdateAll
+// Usage: scriptbench [entity counts...]
+
+#include "Engine/Context.h"
+#include "Engine/Components.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Trivial bodies, so what is measured is the cost of getting into the script
+static const char* perEntitySource = "n = 0 function Update(self, dt) n = n + 1 end\n";
+static const char* batchedSource = "n = 0 function UpdateAll(entities, dt) for i = 1, #entities do n = n + 1 end end\n";
+
+// Microseconds per Update with count entities running the script
+static double Run(const std::string& path, const u32 count)
+{
+	entt::registry registry;
+	entt::dispatcher dispatcher;
+	Renderer renderer;
+	ResourceManager resourceManager;
+	SceneManager sceneManager;
+	SystemManager systemManager;
+	LuaManager luaManager;
+	Logger logger;
+
+	Context context{registry, dispatcher, renderer, resourceManager, sceneManager, systemManager, luaManager, logger};
+	luaManager.SetContext(context);
+
+	for (u32 i = 0; i < count; i++)
+	{
+		entt::entity entity = registry.create();
+		registry.emplace<Component::Transform>(entity);
+		luaManager.LoadEntityScript(entity, path.c_str());
+	}
+
+	// Let the jit settle before timing
+	for (u32 i = 0; i < 5; i++)
+	{
+		luaManager.Update(1.0f / 60);
+	}
+
+	const u32 frames = std::max<u32>(20, 200000 / count);
+
+	const auto start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < frames; i++)
+	{
+		luaManager.Update(1.0f / 60);
+	}
+
+	const std::chrono::duration<double, std::micro> time = std::chrono::steady_clock::now() - start;
+
+	registry.clear();
+
+	return time.count() / frames;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<u32> counts;
+	for (int i = 1; i < argc; i++)
+	{
+		counts.push_back(std::max(1, std::atoi(argv[i])));
+	}
+
+	if (counts.empty())
+	{
+		counts = {1, 2, 4, 8, 16, 64, 256, 1024, 10000};
+	}
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path();
+	const std::string perEntityPath = (directory / "scriptbench_update.lua").string();
+	const std::string batchedPath = (directory / "scriptbench_updateall.lua").string();
+
+	std::ofstream(perEntityPath) << perEntitySource;
+	std::ofstream(batchedPath) << batchedSource;
+
+	std::printf("%8s  %12s  %12s\n", "entities", "per-entity", "batched");
+
+	for (const u32 count : counts)
+	{
+		const double perEntity = Run(perEntityPath, count);
+		const double batched = Run(batchedPath, count);
+
+		std::printf("%8u  %9.2f us  %9.2f us\n", count, perEntity, batched);
+	}
+
+	std::filesystem::remove(perEntityPath);
+	std::filesystem::remove(batchedPath);
+
+	return 0;
+}
\ No newline at end of file